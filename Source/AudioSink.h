@@ -0,0 +1,34 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Types.h"
+#include "Mixer.h"
+
+// receives the mixed samples on the emulation thread, as they are produced in emulated time
+class AudioSink
+{
+public:
+	virtual ~AudioSink() = default;
+
+	virtual void writeSamples(const StereoSample* samples, u16 sampleCount) = 0;
+	// the rate the samples should be generated at, may be adjusted slightly to follow the device clock
+	virtual u32 getSamplingFrequency() const = 0;
+};
@@ -0,0 +1,76 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "BlipBuffer.h"
+#include "SincKernel.h"
+
+constexpr u8 BlipBuffer::FRACTION_BITS;
+constexpr u8 BlipBuffer::PHASE_BITS;
+constexpr u8 BlipBuffer::KERNEL_WIDTH;
+constexpr u8 BlipBuffer::KERNEL_BITS;
+constexpr u16 BlipBuffer::BUFFER_SIZE;
+
+void BlipBuffer::addDelta(u64 time, s32 delta)
+{
+	// relative to the sampling frequency
+	constexpr double CUTOFF = 0.45;
+	static const std::vector<s16> KERNEL = createSincKernel(CUTOFF, KERNEL_WIDTH, 1 << PHASE_BITS, KERNEL_BITS);
+
+	u64 sample = time >> FRACTION_BITS;
+	u8 phase = (time >> (FRACTION_BITS - PHASE_BITS)) & ((1 << PHASE_BITS) - 1);
+
+	if (sample < m_nextSample)
+	{
+		sample = m_nextSample;
+		phase = 0;
+	}
+
+	if (sample + KERNEL_WIDTH - m_nextSample > BUFFER_SIZE)
+		return;
+
+	for (u8 n = 0; n < KERNEL_WIDTH; ++n)
+		m_deltas[(sample + n) & (BUFFER_SIZE - 1)] += delta * KERNEL[phase * KERNEL_WIDTH + n];
+
+	m_settledSample = std::max(m_settledSample, sample + KERNEL_WIDTH);
+}
+
+void BlipBuffer::readSamples(s16* samples, u16 sampleCount)
+{
+	for (u16 n = 0; n < sampleCount; ++n, ++m_nextSample)
+	{
+		s32& delta = m_deltas[m_nextSample & (BUFFER_SIZE - 1)];
+		m_sum += delta;
+		delta = 0;
+		samples[n] = (s16)(m_sum >> KERNEL_BITS);
+	}
+}
+
+bool BlipBuffer::isSilent() const
+{
+	return (m_nextSample >= m_settledSample) && (m_sum == 0);
+}
+
+// the deltas of the skipped samples are already 0
+void BlipBuffer::skipSamples(u16 sampleCount)
+{
+	m_nextSample += sampleCount;
+}
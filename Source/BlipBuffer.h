@@ -0,0 +1,56 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+
+#include "Types.h"
+
+// turns amplitude steps placed at fractional sample times into band-limited samples,
+// the output is delayed by half the kernel width
+class BlipBuffer
+{
+public:
+	// times are sample indices in fixed-point, 20 bits make the time of one cycle at 1 MHz an integer at any rate
+	static constexpr u8 FRACTION_BITS = 20;
+	static constexpr u8 PHASE_BITS = 5;
+	static constexpr u8 KERNEL_WIDTH = 32;
+	// kernel taps of each phase sum to 1 << KERNEL_BITS
+	static constexpr u8 KERNEL_BITS = 15;
+
+	// the time must not be earlier than the next sample to read
+	void addDelta(u64 time, s32 delta);
+	// the samples are complete once every delta up to their time has been added
+	void readSamples(s16* samples, u16 sampleCount);
+
+	// no delta is pending and the output has settled at 0, the next samples can be skipped instead of read
+	bool isSilent() const;
+	void skipSamples(u16 sampleCount);
+
+private:
+	// holds the deltas of a frame sequencer step at the native rate of the APU
+	static constexpr u16 BUFFER_SIZE = 4096;
+
+	std::array<s32, BUFFER_SIZE> m_deltas{};
+	u64 m_nextSample = 0;
+	// first sample after the kernel of the last delta
+	u64 m_settledSample = 0;
+	s32 m_sum = 0;
+};
@@ -0,0 +1,93 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#include "CaptureFrameSink.h"
+#include "PngWriter.h"
+
+constexpr u16 QUEUE_CAPACITY = 16;
+
+CaptureFrameSink::CaptureFrameSink(const std::string& filenamePrefix, u32 captureInterval, u32 frameCount) :
+	m_filenamePrefix(filenamePrefix),
+	m_captureInterval(captureInterval),
+	m_frameNumber(frameCount),
+	m_frames(QUEUE_CAPACITY)
+{
+	m_thread = std::thread(&CaptureFrameSink::encode, this);
+}
+
+CaptureFrameSink::~CaptureFrameSink()
+{
+	m_frames.close();
+	m_thread.join();
+}
+
+void CaptureFrameSink::drawFrame(const Frame& frame)
+{
+	m_lastFrame = frame;
+	captureFrame(frame);
+}
+
+void CaptureFrameSink::repeatFrame()
+{
+	captureFrame(m_lastFrame);
+}
+
+// the last frame is outdated, a requested screenshot waits for the next rendered frame
+void CaptureFrameSink::skipFrame()
+{
+	++m_frameNumber;
+}
+
+void CaptureFrameSink::requestScreenshot()
+{
+	m_screenshotRequested = true;
+}
+
+void CaptureFrameSink::captureFrame(const Frame& frame)
+{
+	++m_frameNumber;
+
+	bool isIntervalFrame = (m_captureInterval != 0) && (m_frameNumber % m_captureInterval == 0);
+
+	// the emulation thread only copies the frame and never waits for the worker thread, which encodes it
+	if ((m_screenshotRequested || isIntervalFrame) && !m_frames.tryPush(frame, m_frameNumber))
+		std::cerr << "Frame " << m_frameNumber << " not captured, the PNG encoder is behind\n";
+
+	m_screenshotRequested = false;
+}
+
+void CaptureFrameSink::encode()
+{
+	Frame frame;
+	u32 frameNumber;
+
+	while (m_frames.pop(frame, frameNumber))
+	{
+		std::ostringstream filename;
+		filename << m_filenamePrefix << std::setw(8) << std::setfill('0') << frameNumber << ".png";
+
+		// a failed capture is reported without stopping the emulation
+		if (!writePng(filename.str(), frame))
+			std::cerr << "ERROR: Failed to write " << filename.str() << "\n";
+	}
+}
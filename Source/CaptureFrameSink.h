@@ -0,0 +1,55 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <thread>
+
+#include "FrameSink.h"
+#include "FrameQueue.h"
+
+// saves screenshots and every nth frame as PNG files, encoded on a worker thread
+class CaptureFrameSink : public FrameSink
+{
+public:
+	// the frame number of the first frame is frameCount + 1
+	CaptureFrameSink(const std::string& filenamePrefix, u32 captureInterval, u32 frameCount);
+	~CaptureFrameSink();
+
+	void drawFrame(const Frame& frame) override;
+	void repeatFrame() override;
+	void skipFrame() override;
+
+	void requestScreenshot();
+
+private:
+	void captureFrame(const Frame& frame);
+	void encode();
+
+	std::string m_filenamePrefix;
+	u32 m_captureInterval;
+	bool m_screenshotRequested = false;
+
+	Frame m_lastFrame{};
+	u32 m_frameNumber = 0;
+
+	FrameQueue m_frames;
+	std::thread m_thread;
+};
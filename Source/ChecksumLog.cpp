@@ -0,0 +1,126 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include "Error.h"
+#include "Hash.h"
+#include "ChecksumLog.h"
+
+ChecksumFrameSink::ChecksumFrameSink(const std::string& filename, bool lineHashes) :
+	m_file(filename),
+	m_lineHashes(lineHashes)
+{
+	if (!m_file)
+		throwError("Failed to open ", filename);
+}
+
+void ChecksumFrameSink::drawFrame(const Frame& frame)
+{
+	std::ostringstream entry;
+	entry << std::hex << std::setfill('0') << std::setw(16) << hashPixels(frame.data(), frame.size());
+
+	if (m_lineHashes)
+	{
+		for (u8 line = 0; line < FRAME_HEIGHT; ++line)
+			entry << ' ' << std::setw(16) << hashPixels(&frame[line * FRAME_WIDTH], FRAME_WIDTH);
+	}
+
+	m_lastEntry = entry.str();
+	repeatFrame();
+}
+
+void ChecksumFrameSink::repeatFrame()
+{
+	m_file << m_frameNumber << ' ' << m_lastEntry << '\n';
+	++m_frameNumber;
+}
+
+std::vector<std::string> splitEntry(const std::string& entry)
+{
+	std::istringstream stream(entry);
+	std::vector<std::string> fields;
+	std::string field;
+
+	while (stream >> field)
+		fields.push_back(field);
+
+	return fields;
+}
+
+bool compareChecksumLogs(const std::string& filename0, const std::string& filename1)
+{
+	std::ifstream file0(filename0), file1(filename1);
+
+	if (!file0)
+		throwError("Failed to open ", filename0);
+
+	if (!file1)
+		throwError("Failed to open ", filename1);
+
+	std::string entry0, entry1;
+	u32 frameCount = 0;
+
+	while (true)
+	{
+		bool hasEntry0 = (bool)std::getline(file0, entry0);
+		bool hasEntry1 = (bool)std::getline(file1, entry1);
+
+		if (!hasEntry0 || !hasEntry1)
+		{
+			if (hasEntry0 == hasEntry1)
+			{
+				std::cout << "The " << frameCount << " frames are identical" << std::endl;
+				return true;
+			}
+
+			std::cout << "The " << frameCount << " common frames are identical, " << (hasEntry0 ? filename1 : filename0) << " has no more frames" << std::endl;
+			return false;
+		}
+
+		// the fields are the frame number, the frame hash and the line hashes if they were logged
+		std::vector<std::string> fields0 = splitEntry(entry0);
+		std::vector<std::string> fields1 = splitEntry(entry1);
+
+		if ((fields0.size() < 2) || (fields1.size() < 2))
+			throwError("Invalid checksum log entry after ", frameCount, " frames");
+
+		if (fields0[1] != fields1[1])
+		{
+			std::cout << "First difference at frame " << fields0[0];
+
+			for (size_t fieldNumber = 2; (fieldNumber < fields0.size()) && (fieldNumber < fields1.size()); ++fieldNumber)
+			{
+				if (fields0[fieldNumber] != fields1[fieldNumber])
+				{
+					std::cout << ", line " << fieldNumber - 2;
+					break;
+				}
+			}
+
+			std::cout << std::endl;
+			return false;
+		}
+
+		++frameCount;
+	}
+}
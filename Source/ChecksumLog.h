@@ -0,0 +1,44 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <fstream>
+
+#include "FrameSink.h"
+
+// writes one line per frame: the frame number, the hash of the frame and optionally the hash of each of its lines
+class ChecksumFrameSink : public FrameSink
+{
+public:
+	ChecksumFrameSink(const std::string& filename, bool lineHashes);
+
+	void drawFrame(const Frame& frame) override;
+	void repeatFrame() override;
+
+private:
+	std::ofstream m_file;
+	bool m_lineHashes;
+	std::string m_lastEntry;
+	u32 m_frameNumber = 0;
+};
+
+// prints the first frame and line that differ between two checksum logs, returns true if they are identical
+bool compareChecksumLogs(const std::string& filename0, const std::string& filename1);
@@ -17,28 +17,69 @@ You should have received a copy of the GNU General Public License
 along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <thread>
+
 #include "Error.h"
 #include "Cpu.h"
+#include "Settings.h"
 
-Cpu::Cpu(Memory& memory) : m_memory(memory), m_displayController(memory, *this), m_soundController(memory)
+Cpu::Cpu(Memory& memory, const Settings& settings) : m_memory(memory), m_displayController(memory, *this, m_scheduler, settings), m_soundController(memory, m_scheduler, settings), m_frameLimit(settings.frameLimit),
+	m_presentationThread(settings.presentationThread && (settings.videoBackend == Settings::SDL_VIDEO))
 {
 	m_registers.SP = 0xFFFE;
 	m_registers.PC = 0x100;
 	m_registers.A = 0x11;
+
+	m_scheduler.setCallback(Scheduler::FRAME_EVENT, [this] { doFrame(); });
+	m_scheduler.schedule(Scheduler::FRAME_EVENT, DisplayController::CYCLES_PER_FRAME);
 }
 
 void Cpu::run()
 {
-	while (!m_eventHandler.isQuitRequested())
+	if (!m_presentationThread)
 	{
-		EventHandler::updateP1(m_memory.P1);
-		handleInterrupts();
+		while (!m_eventHandler.isQuitRequested())
+			step();
 
-		if (m_haltMode)
-			doCycle();
-		else
-			executeNextInstruction();
+		return;
+	}
+
+	// the main thread keeps the window, it presents the frames and polls the events while the emulation runs on its own thread
+	std::thread emulationThread([this]
+	{
+		while (!m_eventHandler.isQuitRequested())
+			step();
+	});
+
+	while (!m_eventHandler.isQuitRequested())
+	{
+		m_displayController.presentFrames();
+		m_eventHandler.pollEvents();
 	}
+
+	emulationThread.join();
+}
+
+bool Cpu::runFrame()
+{
+	u32 frameCount = m_displayController.getFrameCount();
+	u64 lastCycle = m_scheduler.getCurrentCycle() + 2 * DisplayController::CYCLES_PER_FRAME;
+
+	while ((m_displayController.getFrameCount() == frameCount) && (m_scheduler.getCurrentCycle() < lastCycle) && !m_eventHandler.isQuitRequested())
+		step();
+
+	return !m_eventHandler.isQuitRequested();
+}
+
+void Cpu::step()
+{
+	m_eventHandler.updateP1(m_memory.P1);
+	handleInterrupts();
+
+	if (m_haltMode)
+		doCycle();
+	else
+		executeNextInstruction();
 }
 
 void Cpu::executeNextInstruction()
@@ -2816,11 +2857,28 @@ void Cpu::doCycle(u8 cycleCount)
 				continue;
 		}
 
-		m_displayController.doCycle();
-		m_eventHandler.doCycle();
+		m_scheduler.doCycle();
 	}
 }
 
+void Cpu::doFrame()
+{
+	m_displayController.regulateFramerate();
+
+	if (!m_presentationThread)
+		m_eventHandler.pollEvents();
+
+	if (m_eventHandler.takeScreenshotRequest())
+		m_displayController.requestScreenshot();
+
+	++m_frameCounter;
+
+	if (m_frameCounter == m_frameLimit)
+		m_eventHandler.requestQuit();
+
+	m_scheduler.schedule(Scheduler::FRAME_EVENT, m_scheduler.getCurrentCycle() + DisplayController::CYCLES_PER_FRAME);
+}
+
 void Cpu::incrementDIV()
 {
 	constexpr u8 PERIOD = 128;
@@ -2909,8 +2967,16 @@ bool Cpu::isCgbMode()
 	return (cgbSupportCode == 0x80) || (cgbSupportCode == 0xC0);
 }
 
+DisplayController& Cpu::getDisplayController()
+{
+	return m_displayController;
+}
+
 u8 Cpu::readMemory_u8(u16 address)
 {
+	m_displayController.synchronize(address);
+	m_soundController.synchronize(address);
+
 	u8 value = [&]
 	{
 		switch (address)
@@ -2934,6 +3000,9 @@ u16 Cpu::readMemory_u16(u16 address)
 
 void Cpu::writeToMemory(u16 address, u8 value)
 {
+	m_displayController.synchronize(address);
+	m_soundController.synchronize(address);
+
 	switch (address)
 	{
 	case Memory::SC_ADDRESS:
@@ -2944,6 +3013,10 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		}
 		break;
 
+	case Memory::NR11_ADDRESS:
+		m_soundController.writeToNR11(value);
+		break;
+
 	case Memory::NR13_ADDRESS:
 		m_soundController.writeToNR13(value);
 		break;
@@ -2952,6 +3025,10 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		m_soundController.writeToNR14(value);
 		break;
 
+	case Memory::NR21_ADDRESS:
+		m_soundController.writeToNR21(value);
+		break;
+
 	case Memory::NR23_ADDRESS:
 		m_soundController.writeToNR23(value);
 		break;
@@ -2967,6 +3044,10 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		m_memory.NR30 = value;
 		break;
 
+	case Memory::NR31_ADDRESS:
+		m_soundController.writeToNR31(value);
+		break;
+
 	case Memory::NR33_ADDRESS:
 		m_soundController.writeToNR33(value);
 		break;
@@ -2975,6 +3056,10 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		m_soundController.writeToNR34(value);
 		break;
 
+	case Memory::NR41_ADDRESS:
+		m_soundController.writeToNR41(value);
+		break;
+
 	case Memory::NR44_ADDRESS:
 		m_soundController.writeToNR44(value);
 		break;
@@ -2988,12 +3073,22 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		break;
 
 	case Memory::STAT_ADDRESS:
-		m_memory.STAT = (value & 0xF8) | (m_memory.STAT & 0x07);
+		m_displayController.writeToSTAT(value);
+		break;
+
+	case Memory::SCY_ADDRESS:
+	case Memory::SCX_ADDRESS:
+	case Memory::BGP_ADDRESS:
+	case Memory::OBP0_ADDRESS:
+	case Memory::OBP1_ADDRESS:
+	case Memory::WY_ADDRESS:
+	case Memory::WX_ADDRESS:
+		m_displayController.writeToLineRegister(address, value);
 		break;
 
 	case Memory::DMA_ADDRESS:
 		m_memory.DMA = value;
-		m_memory.performDmaTransfer();
+		m_displayController.performDmaTransfer();
 		break;
 
 	case Memory::KEY1_ADDRESS:
@@ -3005,19 +3100,9 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		break;
 
 	case Memory::HDMA5_ADDRESS:
-	{
-		u8 oldValue = m_memory.HDMA5;
-		m_memory.HDMA5 = value & 0x7F;
-
-		if ((value & 0x80) == 0)
-		{
-			if (oldValue & 0x80)
-				m_memory.performHdmaTransfer(m_memory.HDMA5);
-			else
-				m_memory.HDMA5 |= 0x80;
-		}
+		m_displayController.writeToHDMA5(value);
 		break;
-	}
+
 	case Memory::BCPD_ADDRESS:
 		m_memory.BCPD = value;
 		m_displayController.updateBgPaletteColor();
@@ -3029,7 +3114,14 @@ void Cpu::writeToMemory(u16 address, u8 value)
 		break;
 
 	default:
-		m_memory.write(address, value);
+		if ((Memory::DISPLAYRAM_ADDRESS <= address) && (address < Memory::DISPLAYRAM_ADDRESS + Memory::DISPLAYRAM_SIZE))
+			m_displayController.writeToDisplayRam(address, value);
+		else if ((Memory::OAM_ADDRESS <= address) && (address < Memory::OAM_ADDRESS + Memory::OAM_SIZE))
+			m_displayController.writeToOam(address, value);
+		else if ((Memory::WAVEFORMRAM_ADDRESS <= address) && (address < Memory::WAVEFORMRAM_ADDRESS + Memory::WAVEFORMRAM_SIZE))
+			m_soundController.writeToWaveformRam(address, value);
+		else
+			m_memory.write(address, value);
 	}
 
 	doCycle();
@@ -20,10 +20,13 @@ along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include "EventHandler.h"
+#include "Scheduler.h"
 #include "DisplayController.h"
 #include "SoundController.h"
 #include "Memory.h"
 
+struct Settings;
+
 class Cpu
 {
 public:
@@ -36,13 +39,17 @@ public:
 		JOYPAD_INTERRUPT_FLAG = 0x10,
 	};
 
-	Cpu(Memory& memory);
+	Cpu(Memory& memory, const Settings& settings);
 
 	void run();
+	// runs until the next VBLANK, or for two frame periods while the display is off, returns false once a quit is requested
+	bool runFrame();
 	void requestInterrupt(InterruptFlag flag);
 	bool isCgbMode();
+	DisplayController& getDisplayController();
 	
 private:
+	void step();
 	void executeNextInstruction();
 
 	void handleInterrupts();
@@ -52,6 +59,7 @@ private:
 	u16 fetch_u16();
 
 	void doCycle(u8 cycleCount = 1);
+	void doFrame();
 	void incrementDIV();
 	void incrementTIMA();
 
@@ -107,9 +115,14 @@ private:
 
 	Memory& m_memory;
 	EventHandler m_eventHandler;
+	Scheduler m_scheduler;
 	DisplayController m_displayController;
 	SoundController m_soundController;
 
+	u32 m_frameLimit;
+	u32 m_frameCounter = 0;
+	bool m_presentationThread;
+
 	bool m_ime = false;
 	bool m_haltMode = false;
 };
@@ -17,139 +17,362 @@ You should have received a copy of the GNU General Public License
 along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <list>
+#include <iostream>
 #include <chrono>
 #include <thread>
-
-#include <SDL.h>
+#include <algorithm>
 
 #include "Error.h"
 #include "Cpu.h"
 #include "DisplayController.h"
 #include "Memory.h"
+#include "Scheduler.h"
+#include "Settings.h"
+#include "SdlFrameSink.h"
+#include "ThreadedFrameSink.h"
+#include "DumpFrameSink.h"
+#include "CaptureFrameSink.h"
+#include "ChecksumLog.h"
 
 constexpr u8 CHARACTER_DATA_SIZE = 16;
 constexpr u8 CHARACTER_WIDTH = 8;
 constexpr u8 CHARACTERS_PER_LINE = 32;
-constexpr u8 SCREEN_SCALE = 2;
+constexpr u8 BYTES_PER_OBJECT = 4;
+constexpr u8 MAX_OBJECT_HEIGHT = 16;
+constexpr u8 OBJECT_WIDTH = 8;
+
+DisplayController::DisplayController(Memory& memory, Cpu& cpu, Scheduler& scheduler, const Settings& settings) :
+	m_memory(memory),
+	m_cpu(cpu),
+	m_scheduler(scheduler),
+	m_lazyDisplay(settings.lazyDisplay),
+	m_capturePrefix(settings.capturePrefix),
+	m_deferredRendering(settings.renderThreadCount > 0),
+	m_backgroundCacheEnabled(settings.backgroundCache),
+	m_skipIdenticalFrames(settings.skipIdenticalFrames),
+	m_frameSkip(settings.frameSkip),
+	m_adaptiveFrameSkip(settings.adaptiveFrameSkip),
+	m_uncappedSpeed(settings.uncappedSpeed),
+	m_audioSync(settings.audioSync && (settings.audioBackend == Settings::SDL_AUDIO)),
+	m_startTime(std::chrono::steady_clock::now())
+{
+	if (settings.renderThreadCount > 1)
+		m_workerPool = std::make_unique<WorkerPool>(settings.renderThreadCount - 1);
+
+	m_paletteGenerations.reserve(SCREEN_HEIGHT);
+
+	if (m_backgroundCacheEnabled)
+		m_backgroundMapPixels.resize(BACKGROUND_MAP_COUNT * BACKGROUND_MAP_SIZE * BACKGROUND_MAP_SIZE);
+
+	std::unique_ptr<FrameSink> videoFrameSink;
+
+	switch (settings.videoBackend)
+	{
+	case Settings::SDL_VIDEO:
+	{
+		auto sdlFrameSink = std::make_unique<SdlFrameSink>(settings.scalingFilter, settings.scale);
+
+		if (settings.presentationThread)
+			videoFrameSink = std::make_unique<ThreadedFrameSink>(std::move(sdlFrameSink));
+		else
+			videoFrameSink = std::move(sdlFrameSink);
+
+		break;
+	}
+
+	case Settings::NULL_VIDEO:
+		videoFrameSink = std::make_unique<NullFrameSink>();
+		break;
+
+	case Settings::BUFFER_VIDEO:
+		videoFrameSink = std::make_unique<BufferFrameSink>();
+		break;
+	}
+
+	// the video backend is always the first sink
+	m_videoFrameSink = videoFrameSink.get();
+	m_frameSinks.push_back(std::move(videoFrameSink));
+
+	if (!settings.dumpFilename.empty())
+		m_frameSinks.push_back(std::make_unique<DumpFrameSink>(settings.dumpFilename, settings.dumpFormat == Settings::Y4M_DUMP ? DumpFrameSink::Y4M_FORMAT : DumpFrameSink::RGB_FORMAT, settings.uncappedSpeed));
+
+	if (!settings.checksumFilename.empty())
+		m_frameSinks.push_back(std::make_unique<ChecksumFrameSink>(settings.checksumFilename, settings.lineChecksums));
+
+	// otherwise created by the first screenshot
+	if (settings.captureInterval != 0)
+		createCaptureFrameSink(settings.captureInterval);
+
+	for (const std::unique_ptr<FrameSink>& frameSink : m_frameSinks)
+		m_frameSinkEnabled = m_frameSinkEnabled || frameSink->isEnabled();
+
+	// nothing is rendered if the frames are discarded
+	m_skipFrame = !m_frameSinkEnabled;
+
+	m_scheduler.setCallback(Scheduler::DISPLAY_EVENT, [this] { synchronize(); });
 
-void regulateFramerate()
+	if (m_memory.LCDC & 0x80)
+	{
+		m_nextModeCycle = m_scheduler.getCurrentCycle() + 51;
+		scheduleNextEvent();
+	}
+}
+
+DisplayController::~DisplayController()
+{
+	if (m_uncappedSpeed)
+	{
+		std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - m_startTime;
+		std::cout << m_frameCounter << " frames in " << elapsedTime.count() << " s (" << m_frameCounter / elapsedTime.count() << " fps)" << std::endl;
+
+		if (m_skipIdenticalFrames)
+			std::cout << m_repeatedFrameCount << " identical frames not presented" << std::endl;
+	}
+}
+
+void DisplayController::regulateFramerate()
 {
 	constexpr auto TIME_PER_FRAME = std::chrono::nanoseconds(16'742'706);
 
-	static u16 cycleCounter = 0;
-	++cycleCounter;
+	if (m_uncappedSpeed)
+		return;
 
-	if (cycleCounter == DisplayController::CYCLES_PER_FRAME)
-	{
-		cycleCounter = 0;
+	static auto lastFrameTime = std::chrono::steady_clock::now();
+	auto currentTime = std::chrono::steady_clock::now();
+	auto elapsedTime = currentTime - lastFrameTime;
 
-		static auto lastFrameTime = std::chrono::steady_clock::now();
-		auto currentTime = std::chrono::steady_clock::now();
-		auto elapsedTime = currentTime - lastFrameTime;
+	m_late = elapsedTime > TIME_PER_FRAME;
 
-		if (elapsedTime < TIME_PER_FRAME)
-		{
+	if (elapsedTime < TIME_PER_FRAME)
+	{
+		// the audio sink paces the emulation, only the lateness is tracked
+		if (!m_audioSync)
 			std::this_thread::sleep_for(TIME_PER_FRAME - elapsedTime);
-			lastFrameTime += TIME_PER_FRAME;
-		}
-		else
-			lastFrameTime = currentTime;
+
+		lastFrameTime += TIME_PER_FRAME;
 	}
+	else
+		lastFrameTime = currentTime;
 }
 
-DisplayController::DisplayController(Memory& memory, Cpu& cpu) : m_memory(memory), m_cpu(cpu)
+void DisplayController::synchronize(u16 address)
 {
-	if (SDL_InitSubSystem(SDL_INIT_VIDEO))
-		throwError("Failed to init video: ", SDL_GetError());
+	if (!m_lazyDisplay)
+		return;
+
+	bool isDisplayAddress = ((Memory::DISPLAYRAM_ADDRESS <= address) && (address < Memory::DISPLAYRAM_ADDRESS + Memory::DISPLAYRAM_SIZE))
+		|| ((Memory::OAM_ADDRESS <= address) && (address < Memory::OAM_ADDRESS + Memory::OAM_SIZE))
+		|| ((Memory::LCDC_ADDRESS <= address) && (address <= Memory::WX_ADDRESS))
+		|| ((Memory::HDMA1_ADDRESS <= address) && (address <= Memory::HDMA5_ADDRESS))
+		|| ((Memory::BCPS_ADDRESS <= address) && (address <= Memory::OCPD_ADDRESS));
 
-	m_window = SDL_CreateWindow("CppGB", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH * SCREEN_SCALE, SCREEN_HEIGHT * SCREEN_SCALE, SDL_WINDOW_SHOWN);
-	
-	if (!m_window)
-		throwError("Failed to create window: ", SDL_GetError());
+	if (isDisplayAddress)
+		synchronize();
 }
 
-DisplayController::~DisplayController()
+void DisplayController::writeToLCDC(u8 value)
 {
-	SDL_DestroyWindow(m_window);
-	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+	u8 oldValue = m_memory.LCDC;
+
+	// the pending lines share the object lines and background cache, which depend on these bits
+	if ((value ^ oldValue) & 0x94)
+		renderPendingLines();
+
+	m_memory.LCDC = value;
+
+	if ((value & 0x80) == 0 && (oldValue & 0x80)) // check if display is disabled
+	{
+		m_memory.LY = 0;
+		m_memory.STAT &= 0xFC;
+		m_scheduler.unschedule(Scheduler::DISPLAY_EVENT);
+	}
+	else if ((value & 0x80) && (oldValue & 0x80) == 0) // check if display is enabled
+	{
+		m_nextModeCycle = m_scheduler.getCurrentCycle();
+		changeMode(HBLANK_MODE_FLAG, 51);
+		scheduleNextEvent();
+	}
+
+	if ((value ^ oldValue) & 0x04) // object size changed ?
+		m_objectLinesOutdated = true;
+
+	splitPixelLine();
 }
 
-void DisplayController::doCycle()
+void DisplayController::writeToSTAT(u8 value)
 {
-	regulateFramerate();
+	m_memory.STAT = (value & 0xF8) | (m_memory.STAT & 0x07);
 
-	if ((m_memory.LCDC & 0x80) == 0)
-		return;
+	if (m_memory.LCDC & 0x80)
+		scheduleNextEvent();
+}
+
+void DisplayController::writeToLineRegister(u16 address, u8 value)
+{
+	m_memory.write(address, value);
+	splitPixelLine();
+}
 
-	++m_cycleCounter;
+void DisplayController::writeToHDMA5(u8 value)
+{
+	u8 oldValue = m_memory.HDMA5;
+	m_memory.HDMA5 = value & 0x7F;
 
-	switch (m_memory.STAT & 0x03)
+	if ((value & 0x80) == 0)
 	{
-	case HBLANK_MODE_FLAG:
-		if (m_cycleCounter == 51)
-		{
-			updateLY(m_memory.LY + 1);
+		if (oldValue & 0x80)
+			performHdmaTransfer(m_memory.HDMA5);
+		else
+			m_memory.HDMA5 |= 0x80;
+	}
 
-			if (m_memory.LY < 144)
-				changeMode(OAMSEARCH_MODE_FLAG);
-			else
-			{
-				drawFrame();
-				changeMode(VBLANK_MODE_FLAG);
-				m_cpu.requestInterrupt(Cpu::VBLANK_INTERRUPT_FLAG);
-			}
-		}
-		break;
+	if (m_memory.LCDC & 0x80)
+		scheduleNextEvent();
+}
 
-	case VBLANK_MODE_FLAG:
-		if ((m_cycleCounter == 1) && (m_memory.LY == 153))
-			updateLY(0);
-		else if (m_cycleCounter == 114)
-		{
-			if (m_memory.LY == 0)
-				changeMode(OAMSEARCH_MODE_FLAG);
-			else
-			{
-				m_cycleCounter = 0;
-				updateLY(m_memory.LY + 1);
-			}
-		}
-		break;
+void DisplayController::writeToDisplayRam(u16 address, u8 value)
+{
+	renderPendingLines();
+	m_memory.write(address, value);
+	invalidateDisplayRam(address, m_memory.VBK);
+}
 
-	case OAMSEARCH_MODE_FLAG:
-		if (m_cycleCounter == 20)
+void DisplayController::writeToOam(u16 address, u8 value)
+{
+	renderPendingLines();
+	m_memory.write(address, value);
+	m_objectLinesOutdated = true;
+}
+
+void DisplayController::performDmaTransfer()
+{
+	renderPendingLines();
+	m_memory.performDmaTransfer();
+	m_objectLinesOutdated = true;
+}
+
+void DisplayController::performHdmaTransfer(u8 n)
+{
+	u16 transferSize = 16 * (n + 1);
+	u16 destinationOffset = ((m_memory.HDMA3 & 0x1F) << 8) | (m_memory.HDMA4 & 0xF0);
+	u8 bankNumber = m_memory.VBK;
+
+	renderPendingLines();
+	m_memory.performHdmaTransfer(n);
+
+	if (m_backgroundCacheEnabled)
+	{
+		for (u16 byteCounter = 0; (byteCounter < transferSize) && (destinationOffset + byteCounter < Memory::DISPLAYRAM_SIZE); ++byteCounter)
+			invalidateDisplayRam(Memory::DISPLAYRAM_ADDRESS + destinationOffset + byteCounter, bankNumber);
+	}
+}
+
+// the video sink is kept aside, the emulation thread may add a sink to the list meanwhile
+void DisplayController::presentFrames()
+{
+	m_videoFrameSink->present();
+}
+
+FrameSink& DisplayController::getFrameSink()
+{
+	return *m_frameSinks.front();
+}
+
+u32 DisplayController::getFrameCount()
+{
+	return m_frameCounter;
+}
+
+void DisplayController::enableObservations()
+{
+	m_observationsEnabled = true;
+	m_skipFrame = false;
+}
+
+void DisplayController::readColorIndices(u8* buffer)
+{
+	bool isCgbMode = m_cpu.isCgbMode();
+
+	for (u16 pixelOffset = 0; pixelOffset < m_frameBuffer.size(); pixelOffset += 4)
+	{
+		u8 byte = 0;
+
+		for (u8 pixelNumber = 0; pixelNumber < 4; ++pixelNumber)
 		{
-			changeMode(PIXELTRANSFER_MODE_FLAG);
-			transferPixelLine();
+			const Pixel& pixel = m_frameBuffer[pixelOffset + pixelNumber];
+			byte |= (isCgbMode ? pixel.colorNumber : pixel.dmgColor) << (pixelNumber * 2);
 		}
-		break;
 
-	case PIXELTRANSFER_MODE_FLAG:
-		if (m_cycleCounter == 43)
+		buffer[pixelOffset / 4] = byte;
+	}
+}
+
+void DisplayController::readLuminance(u8* buffer, u8 width, u8 height)
+{
+	constexpr std::array<u8, 4> DMG_LUMINANCES = { 0xFF, 0xAA, 0x55, 0x00 };
+
+	// the box filter only reduces the screen
+	if ((width == 0) || (height == 0) || (width > SCREEN_WIDTH) || (height > SCREEN_HEIGHT))
+		throwError("Invalid observation size: ", (u32)width, "x", (u32)height);
+
+	bool isCgbMode = m_cpu.isCgbMode();
+
+	auto getLuminance = [&](const Pixel& pixel) -> u32
+	{
+		if (!isCgbMode)
+			return DMG_LUMINANCES[pixel.dmgColor];
+
+		// BT.601 luma of the 5-bit components
+		Color color = pixel.cgbColor;
+		return (299 * color.red + 587 * color.green + 114 * color.blue) * 0xFF / (1000 * 0x1F);
+	};
+
+	if ((width == SCREEN_WIDTH) && (height == SCREEN_HEIGHT))
+	{
+		for (u16 pixelOffset = 0; pixelOffset < m_frameBuffer.size(); ++pixelOffset)
+			buffer[pixelOffset] = (u8)getLuminance(m_frameBuffer[pixelOffset]);
+
+		return;
+	}
+
+	// each output pixel is the average of the screen pixels it covers
+	for (u8 y = 0; y < height; ++y)
+	{
+		u8 firstLine = y * SCREEN_HEIGHT / height;
+		u8 endLine = std::max<u8>((y + 1) * SCREEN_HEIGHT / height, firstLine + 1);
+
+		for (u8 x = 0; x < width; ++x)
 		{
-			changeMode(HBLANK_MODE_FLAG);
+			u8 firstColumn = x * SCREEN_WIDTH / width;
+			u8 endColumn = std::max<u8>((x + 1) * SCREEN_WIDTH / width, firstColumn + 1);
+			u32 luminanceSum = 0;
 
-			if ((m_memory.HDMA5 & 0x80) == 0)
-				m_memory.performHdmaTransfer(0);
+			for (u8 line = firstLine; line < endLine; ++line)
+			{
+				for (u8 column = firstColumn; column < endColumn; ++column)
+					luminanceSum += getLuminance(m_frameBuffer[line * SCREEN_WIDTH + column]);
+			}
 
-			if (m_memory.STAT & 0x08)
-				m_cpu.requestInterrupt(Cpu::LCDSTAT_INTERRUPT_FLAG);
+			u16 pixelCount = (endLine - firstLine) * (endColumn - firstColumn);
+			buffer[y * width + x] = (u8)((luminanceSum + pixelCount / 2) / pixelCount);
 		}
-		break;
 	}
 }
 
-void DisplayController::writeToLCDC(u8 value)
+void DisplayController::requestScreenshot()
 {
-	u8 oldValue = m_memory.LCDC;
-	m_memory.LCDC = value;
+	if (!m_captureFrameSink)
+		createCaptureFrameSink(0);
 
-	if ((value & 0x80) == 0 && (oldValue & 0x80)) // check if display is disabled
-	{
-		m_memory.LY = 0;
-		changeMode(HBLANK_MODE_FLAG);
-	}
+	m_captureFrameSink->requestScreenshot();
+}
+
+void DisplayController::createCaptureFrameSink(u32 captureInterval)
+{
+	auto captureFrameSink = std::make_unique<CaptureFrameSink>(m_capturePrefix, captureInterval, m_frameCounter);
+	m_captureFrameSink = captureFrameSink.get();
+	m_frameSinks.push_back(std::move(captureFrameSink));
+	m_frameSinkEnabled = true;
 }
 
 u8 DisplayController::readBgPaletteColor()
@@ -184,6 +407,9 @@ void DisplayController::updateBgPaletteColor()
 	else
 		m_bgColorPalettes[paletteNumber].color[colorNumber].L = m_memory.BCPD;
 
+	m_palettesChanged = true;
+	splitPixelLine();
+
 	if (m_memory.BCPS & 0x80)
 		m_memory.BCPS = (m_memory.BCPS & 0xBF) + 1;
 }
@@ -198,10 +424,130 @@ void DisplayController::updateObjPaletteColor()
 	else
 		m_objColorPalettes[paletteNumber].color[colorNumber].L = m_memory.OCPD;
 
+	m_palettesChanged = true;
+	splitPixelLine();
+
 	if (m_memory.OCPS & 0x80)
 		m_memory.OCPS = (m_memory.OCPS & 0xBF) + 1;
 }
 
+void DisplayController::synchronize()
+{
+	if ((m_memory.LCDC & 0x80) == 0)
+		return;
+
+	while (m_nextModeCycle <= m_scheduler.getCurrentCycle())
+		updateMode();
+
+	scheduleNextEvent();
+}
+
+void DisplayController::scheduleNextEvent()
+{
+	if (!m_lazyDisplay)
+	{
+		m_scheduler.schedule(Scheduler::DISPLAY_EVENT, m_nextModeCycle);
+		return;
+	}
+
+	// in lazy mode, only wake up when the CPU could notice a mode change without accessing the display registers
+	u8 mode = m_memory.STAT & 0x03;
+	bool isHdmaActive = (m_memory.HDMA5 & 0x80) == 0;
+	bool isLcdStatInterruptEnabled = m_memory.STAT & 0x48;
+
+	if (isHdmaActive || isLcdStatInterruptEnabled || (mode == VBLANK_MODE_FLAG))
+	{
+		m_scheduler.schedule(Scheduler::DISPLAY_EVENT, m_nextModeCycle);
+		return;
+	}
+
+	// wake up at the start of the VBLANK
+	u64 vblankCycle = m_nextModeCycle;
+
+	if (mode == OAMSEARCH_MODE_FLAG)
+		vblankCycle += 43 + 51;
+	else if (mode == PIXELTRANSFER_MODE_FLAG)
+		vblankCycle += 51;
+
+	vblankCycle += (143 - m_memory.LY) * 114;
+	m_scheduler.schedule(Scheduler::DISPLAY_EVENT, vblankCycle);
+}
+
+void DisplayController::updateMode()
+{
+	switch (m_memory.STAT & 0x03)
+	{
+	case HBLANK_MODE_FLAG:
+		updateLY(m_memory.LY + 1);
+
+		if (m_memory.LY < 144)
+			changeMode(OAMSEARCH_MODE_FLAG, 20);
+		else
+		{
+			++m_frameCounter;
+
+			if (!m_skipFrame)
+			{
+				renderPendingLines();
+
+				// the frame may only be rendered for the observations
+				if (m_frameSinkEnabled)
+					drawFrame();
+			}
+			else
+			{
+				for (const std::unique_ptr<FrameSink>& frameSink : m_frameSinks)
+					frameSink->skipFrame();
+			}
+
+			// only the current palettes are kept for the next frame
+			m_paletteGenerations.clear();
+			m_palettesChanged = true;
+
+			updateFrameSkip();
+			changeMode(VBLANK_MODE_FLAG, 114);
+			m_cpu.requestInterrupt(Cpu::VBLANK_INTERRUPT_FLAG);
+		}
+		break;
+
+	case VBLANK_MODE_FLAG:
+		if (m_memory.LY == 153)
+		{
+			updateLY(0);
+			changeMode(VBLANK_MODE_FLAG, 113);
+		}
+		else if (m_memory.LY == 0)
+			changeMode(OAMSEARCH_MODE_FLAG, 20);
+		else
+		{
+			updateLY(m_memory.LY + 1);
+			changeMode(VBLANK_MODE_FLAG, (m_memory.LY == 153) ? 1 : 114);
+		}
+		break;
+
+	case OAMSEARCH_MODE_FLAG:
+		changeMode(PIXELTRANSFER_MODE_FLAG, PIXELTRANSFER_CYCLES);
+
+		if (!m_skipFrame)
+			transferPixelLine();
+		break;
+
+	case PIXELTRANSFER_MODE_FLAG:
+		changeMode(HBLANK_MODE_FLAG, 51);
+
+		// renders the line again if it was split by a register write
+		if (!m_deferredRendering)
+			renderPendingLines();
+
+		if ((m_memory.HDMA5 & 0x80) == 0)
+			performHdmaTransfer(0);
+
+		if (m_memory.STAT & 0x08)
+			m_cpu.requestInterrupt(Cpu::LCDSTAT_INTERRUPT_FLAG);
+		break;
+	}
+}
+
 void DisplayController::updateLY(u8 value)
 {
 	m_memory.LY = value;
@@ -210,34 +556,237 @@ void DisplayController::updateLY(u8 value)
 		m_cpu.requestInterrupt(Cpu::LCDSTAT_INTERRUPT_FLAG);
 }
 
-void DisplayController::changeMode(ModeFlag flag)
+void DisplayController::changeMode(ModeFlag flag, u8 cycleCount)
 {
-	m_cycleCounter = 0;
 	m_memory.STAT = (m_memory.STAT & 0xFC) | flag;
+	m_nextModeCycle += cycleCount;
 }
 
 void DisplayController::transferPixelLine()
 {
-	if (m_memory.LCDC & 0x01)
-		transferPixelLine_background();
+	m_lineRegisters[m_memory.LY] = getLineRegisters();
+	m_lineSegments[m_memory.LY].clear();
+
+	if (m_pendingLineCount == 0)
+		m_firstPendingLine = m_memory.LY;
+
+	++m_pendingLineCount;
+
+	if (!m_deferredRendering)
+		renderPendingLines();
+}
+
+void DisplayController::splitPixelLine()
+{
+	// only a write during the pixel transfer of a rendered line affects part of it
+	if (((m_memory.STAT & 0x03) != PIXELTRANSFER_MODE_FLAG) || ((m_memory.LCDC & 0x80) == 0) || m_skipFrame)
+		return;
 
-	if (m_memory.LCDC & 0x20)
-		transferPixelLine_window();
+	u16 dot = (PIXELTRANSFER_CYCLES - (u16)(m_nextModeCycle - m_scheduler.getCurrentCycle())) * 4;
+	u8 x = getPixelAtDot(dot);
 
-	if (m_memory.LCDC & 0x02)
-		transferPixelLine_objects();
+	if (x == SCREEN_WIDTH)
+		return;
+
+	std::vector<LineSegment>& lineSegments = m_lineSegments[m_memory.LY];
+
+	if (x == 0)
+		m_lineRegisters[m_memory.LY] = getLineRegisters();
+	else if (!lineSegments.empty() && (lineSegments.back().firstX == x))
+		lineSegments.back().registers = getLineRegisters();
+	else
+		lineSegments.push_back({ x, getLineRegisters() });
+
+	// the line is always the last one recorded, it is rendered again if it isn't pending anymore
+	if (m_pendingLineCount == 0)
+	{
+		m_firstPendingLine = m_memory.LY;
+		m_pendingLineCount = 1;
+	}
 }
 
-void DisplayController::transferPixelLine_background()
+u8 DisplayController::getPixelAtDot(u16 dot)
 {
-	u16 characterCodeAreaAddress = (m_memory.LCDC & 0x08) ? 0x9C00 : 0x9800;
+	constexpr u8 FIRST_PIXEL_DOT = 12;
+	constexpr u8 WINDOW_FETCH_DOTS = 6;
+	constexpr u8 OBJECT_FETCH_DOTS = 6;
+	constexpr u8 HIDDEN_OBJECT_FETCH_DOTS = 11;
+
+	// the fetcher timing of the current line, from its registers at the start of the pixel transfer:
+	// the first pixel comes after the first tile fetch and the pixels discarded by the fine scroll,
+	// the window restarts the fetch and every object stalls it, depending on its position in the tile
+	if (m_objectLinesOutdated)
+		updateObjectLines();
+
+	const LineRegisters& registers = m_lineRegisters[m_memory.LY];
+	const ObjectLine& objectLine = m_objectLines[m_memory.LY];
+	bool objectsEnabled = (registers.LCDC & 0x02) != 0;
+	bool windowEnabled = (registers.LCDC & 0x20) && (registers.WY <= m_memory.LY) && (registers.WX < SCREEN_WIDTH + 7);
+	u8 windowX = (registers.WX < 7) ? 0 : registers.WX - 7;
+
+	u8 tileOffset = registers.SCX & 0x07;
+	u32 fetchedTiles = 0;
+	u16 pixelDot = FIRST_PIXEL_DOT + tileOffset;
+
+	for (u8 x = 0; x < SCREEN_WIDTH; ++x)
+	{
+		if (windowEnabled && (x == windowX))
+		{
+			pixelDot += WINDOW_FETCH_DOTS;
+			tileOffset = (7 - registers.WX) & 0x07;
+			fetchedTiles = 0;
+		}
+
+		for (u8 objectNumber = 0; objectsEnabled && (objectNumber < objectLine.objectCount); ++objectNumber)
+		{
+			u8 objectX = objectLine.objects[objectNumber].x;
+
+			if ((objectX >= SCREEN_WIDTH + 8) || (std::max<u8>(objectX, 8) - 8 != x))
+				continue;
+
+			// the tile index and the pixel are counted from 8 pixels left of the screen
+			u8 tile = (objectX + tileOffset) / 8;
+			u8 pixel = (objectX + tileOffset) % 8;
+
+			if (objectX == 0)
+				pixelDot += HIDDEN_OBJECT_FETCH_DOTS;
+			else if (fetchedTiles & (1 << tile))
+				pixelDot += OBJECT_FETCH_DOTS;
+			else
+				pixelDot += OBJECT_FETCH_DOTS + ((pixel < 5) ? 5 - pixel : 0);
+
+			fetchedTiles |= 1 << tile;
+		}
+
+		if (pixelDot >= dot)
+			return x;
+
+		++pixelDot;
+	}
+
+	return SCREEN_WIDTH;
+}
+
+DisplayController::LineRegisters DisplayController::getLineRegisters()
+{
+	if (m_paletteGenerations.empty() || m_palettesChanged)
+	{
+		m_paletteGenerations.push_back({ m_bgColorPalettes, m_objColorPalettes });
+		m_palettesChanged = false;
+	}
+
+	LineRegisters registers;
+	registers.LCDC = m_memory.LCDC;
+	registers.SCY = m_memory.SCY;
+	registers.SCX = m_memory.SCX;
+	registers.WY = m_memory.WY;
+	registers.WX = m_memory.WX;
+	registers.BGP = m_memory.BGP;
+	registers.OBP0 = m_memory.OBP0;
+	registers.OBP1 = m_memory.OBP1;
+	registers.paletteGeneration = (u16)(m_paletteGenerations.size() - 1);
+	return registers;
+}
+
+void DisplayController::renderPendingLines()
+{
+	if (m_pendingLineCount == 0)
+		return;
+
+	// the shared state is brought up to date first, the lines then only read it
+	if (m_objectLinesOutdated)
+		updateObjectLines();
+
+	if (m_backgroundCacheEnabled)
+	{
+		for (u8 line = m_firstPendingLine; line < m_firstPendingLine + m_pendingLineCount; ++line)
+		{
+			prepareLineSegment(line, m_lineRegisters[line]);
+
+			for (const LineSegment& lineSegment : m_lineSegments[line])
+				prepareLineSegment(line, lineSegment.registers);
+		}
+	}
+
+	if (m_workerPool && (m_pendingLineCount > 1))
+		m_workerPool->run(m_pendingLineCount, [this](u16 taskNumber) { renderLine((u8)(m_firstPendingLine + taskNumber)); });
+	else
+	{
+		for (u8 line = m_firstPendingLine; line < m_firstPendingLine + m_pendingLineCount; ++line)
+			renderLine(line);
+	}
+
+	m_pendingLineCount = 0;
+}
+
+void DisplayController::prepareLineSegment(u8 line, const LineRegisters& registers)
+{
+	// the cache only holds the characters of the current data area, other segments are decoded directly
+	if ((registers.LCDC ^ m_memory.LCDC) & 0x10)
+		return;
+
+	if (registers.LCDC & 0x01)
+		updateBackgroundMapLine((registers.LCDC & 0x08) ? 1 : 0, line + registers.SCY);
+
+	if ((registers.LCDC & 0x20) && (registers.WY <= line))
+		updateBackgroundMapLine((registers.LCDC & 0x40) ? 1 : 0, line - registers.WY);
+}
+
+void DisplayController::renderLine(u8 line)
+{
+	const std::vector<LineSegment>& lineSegments = m_lineSegments[line];
+
+	// fast path for the lines whose registers didn't change during the pixel transfer
+	if (lineSegments.empty())
+	{
+		renderLineSegment(line, m_lineRegisters[line], 0, SCREEN_WIDTH);
+		return;
+	}
+
+	const LineRegisters* registers = &m_lineRegisters[line];
+	u8 firstX = 0;
+
+	for (const LineSegment& lineSegment : lineSegments)
+	{
+		renderLineSegment(line, *registers, firstX, lineSegment.firstX);
+		registers = &lineSegment.registers;
+		firstX = lineSegment.firstX;
+	}
+
+	renderLineSegment(line, *registers, firstX, SCREEN_WIDTH);
+}
+
+void DisplayController::renderLineSegment(u8 line, const LineRegisters& registers, u8 firstX, u8 endX)
+{
+	if (registers.LCDC & 0x01)
+		renderLine_background(line, registers, firstX, endX);
+
+	if (registers.LCDC & 0x20)
+		renderLine_window(line, registers, firstX, endX);
+
+	if (registers.LCDC & 0x02)
+		renderLine_objects(line, registers, firstX, endX);
+}
+
+void DisplayController::renderLine_background(u8 line, const LineRegisters& registers, u8 firstX, u8 endX)
+{
+	const std::array<ColorPalette, 8>& bgColorPalettes = m_paletteGenerations[registers.paletteGeneration].bgColorPalettes;
+	u16 characterCodeAreaAddress = (registers.LCDC & 0x08) ? 0x9C00 : 0x9800;
+
+	u8 y_background = line + registers.SCY;
+
+	if (m_backgroundCacheEnabled && (((registers.LCDC ^ m_memory.LCDC) & 0x10) == 0))
+	{
+		u8 mapNumber = (registers.LCDC & 0x08) ? 1 : 0;
+		copyBackgroundMapLine(line, registers, mapNumber, y_background, registers.SCX + firstX, firstX, endX);
+		return;
+	}
 
-	u8 y_background = m_memory.LY + m_memory.SCY;
 	u8 characterLine = y_background / CHARACTER_WIDTH;
 
-	for (u8 x_screen = 0; x_screen < SCREEN_WIDTH; ++x_screen)
+	for (u8 x_screen = firstX; x_screen < endX; ++x_screen)
 	{
-		u8 x_background = x_screen + m_memory.SCX;
+		u8 x_background = x_screen + registers.SCX;
 		u8 characterColumn = x_background / CHARACTER_WIDTH;
 		u8 x_character = x_background % CHARACTER_WIDTH;
 
@@ -254,69 +803,61 @@ void DisplayController::transferPixelLine_background()
 
 		u8 y_character = verticalFlip ? (7 - y_background % CHARACTER_WIDTH) : (y_background % CHARACTER_WIDTH);
 
-		u16 characterDataAddress = (m_memory.LCDC & 0x10) ? (0x8000 + characterCode * CHARACTER_DATA_SIZE) : (0x9000 + (s8)characterCode * CHARACTER_DATA_SIZE);
+		u16 characterDataAddress = (registers.LCDC & 0x10) ? (0x8000 + characterCode * CHARACTER_DATA_SIZE) : (0x9000 + (s8)characterCode * CHARACTER_DATA_SIZE);
 		u8 byte0 = m_memory.readDisplayRam(characterDataAddress + y_character * 2, characterDataBankNumber);
 		u8 byte1 = m_memory.readDisplayRam(characterDataAddress + y_character * 2 + 1, characterDataBankNumber);
 		u8 bitNumber = horizontalFlip ? x_character : 7 - x_character;
 		u8 bit0 = (byte0 >> bitNumber) & 1;
 		u8 bit1 = (byte1 >> bitNumber) & 1;
 		u8 pixel = (bit1 << 1) | bit0;
-		u16 pixelOffset = m_memory.LY * SCREEN_WIDTH + x_screen;
+		u16 pixelOffset = line * SCREEN_WIDTH + x_screen;
 
 		m_frameBuffer[pixelOffset].backgroundValue = pixel;
+		m_frameBuffer[pixelOffset].colorNumber = pixel;
 		m_frameBuffer[pixelOffset].backgroundPriority = backgroundPriority;
-		m_frameBuffer[pixelOffset].dmgColor = (m_memory.BGP >> (pixel * 2)) & 0x03;
-		m_frameBuffer[pixelOffset].cgbColor = m_bgColorPalettes[colorPaletteNumber].color[pixel];
+		m_frameBuffer[pixelOffset].dmgColor = (registers.BGP >> (pixel * 2)) & 0x03;
+		m_frameBuffer[pixelOffset].cgbColor = bgColorPalettes[colorPaletteNumber].color[pixel];
 	}
 }
 
-void DisplayController::transferPixelLine_objects()
+void DisplayController::renderLine_objects(u8 line, const LineRegisters& registers, u8 firstX, u8 endX)
 {
-	constexpr u8 OBJECT_COUNT = 40;
-	constexpr u8 MAX_VISIBLE_OBJECTS = 10;
-	constexpr u8 BYTES_PER_OBJECT = 4;
-	constexpr u8 MAX_OBJECT_HEIGHT = 16;
-	constexpr u8 OBJECT_WIDTH = 8;
-
-	u8 objectHeight = (m_memory.LCDC & 0x04) ? 16 : 8;
-
-	std::list<u16> visibleObjectAddresses;
+	const std::array<ColorPalette, 8>& objColorPalettes = m_paletteGenerations[registers.paletteGeneration].objColorPalettes;
+	u8 objectHeight = (registers.LCDC & 0x04) ? 16 : 8;
+	const ObjectLine& objectLine = m_objectLines[line];
 
-	for (u8 objectNumber = 0; (objectNumber < OBJECT_COUNT) && (visibleObjectAddresses.size() < MAX_VISIBLE_OBJECTS); ++objectNumber)
+	// objects with a lower OAM index are drawn last to be displayed on top
+	for (u8 objectNumber = objectLine.objectCount; objectNumber > 0; --objectNumber)
 	{
-		u16 objectAddress = Memory::OAM_ADDRESS + objectNumber * BYTES_PER_OBJECT;
-		s16 objectY = m_memory.read(objectAddress) - MAX_OBJECT_HEIGHT;
-
-		if ((objectY <= m_memory.LY) && (m_memory.LY < objectY + objectHeight))
-			visibleObjectAddresses.push_front(objectAddress);
-	}
+		const Object& object = objectLine.objects[objectNumber - 1];
 
-	for (u16 objectAddress : visibleObjectAddresses)
-	{
-		u8 objectY = m_memory.read(objectAddress) - MAX_OBJECT_HEIGHT;
-		u8 objectX = m_memory.read(objectAddress + 1) - OBJECT_WIDTH;
-		u8 characterCode = m_memory.read(objectAddress + 2);
-		u8 objectAttributes = m_memory.read(objectAddress + 3);
+		u8 objectY = object.y - MAX_OBJECT_HEIGHT;
+		u8 objectX = object.x - OBJECT_WIDTH;
+		u8 characterCode = object.characterCode;
+		u8 objectAttributes = object.attributes;
 
 		if (objectHeight == 16)
 			characterCode &= 0xFE;
 
 		u8 colorPaletteNumber = objectAttributes & 0x07;
 		u8 characterDataBankNumber = (objectAttributes & 0x08) >> 3;
-		u8 OBP = (objectAttributes & 0x10) ? m_memory.OBP1 : m_memory.OBP0;
+		u8 OBP = (objectAttributes & 0x10) ? registers.OBP1 : registers.OBP0;
 		bool horizontalFlip = objectAttributes & 0x20;
 		bool verticalFlip = objectAttributes & 0x40;
 		bool backgroundPriority = objectAttributes & 0x80;
 
-		u8 y_object = verticalFlip ? (objectHeight - 1 - m_memory.LY + objectY) : (m_memory.LY - objectY);
+		u8 y_object = verticalFlip ? (objectHeight - 1 - line + objectY) : (line - objectY);
 		
 		u16 characterDataAddress = 0x8000 + characterCode * CHARACTER_DATA_SIZE;
 		u8 byte0 = m_memory.readDisplayRam(characterDataAddress + y_object * 2, characterDataBankNumber);
 		u8 byte1 = m_memory.readDisplayRam(characterDataAddress + y_object * 2 + 1, characterDataBankNumber);
 
-		for (u8 x_screen = (objectX < SCREEN_WIDTH ? objectX : 0), x_object = (objectX < SCREEN_WIDTH ? 0 : - objectX); (x_screen < SCREEN_WIDTH) && (x_object < OBJECT_WIDTH); ++x_screen, ++x_object)
+		for (u8 x_screen = (objectX < SCREEN_WIDTH ? objectX : 0), x_object = (objectX < SCREEN_WIDTH ? 0 : - objectX); (x_screen < endX) && (x_object < OBJECT_WIDTH); ++x_screen, ++x_object)
 		{
-			u16 pixelOffset = m_memory.LY * SCREEN_WIDTH + x_screen;
+			if (x_screen < firstX)
+				continue;
+
+			u16 pixelOffset = line * SCREEN_WIDTH + x_screen;
 
 			if ((!backgroundPriority && !m_frameBuffer[pixelOffset].backgroundPriority) || (m_frameBuffer[pixelOffset].backgroundValue == 0))
 			{
@@ -327,28 +868,42 @@ void DisplayController::transferPixelLine_objects()
 
 				if (pixel != 0) // 0 => transparent
 				{
+					m_frameBuffer[pixelOffset].colorNumber = pixel;
 					m_frameBuffer[pixelOffset].dmgColor = (OBP >> (pixel * 2)) & 0x03;
-					m_frameBuffer[pixelOffset].cgbColor = m_objColorPalettes[colorPaletteNumber].color[pixel];
+					m_frameBuffer[pixelOffset].cgbColor = objColorPalettes[colorPaletteNumber].color[pixel];
 				}
 			}
 		}
 	}
 }
 
-void DisplayController::transferPixelLine_window()
+void DisplayController::renderLine_window(u8 line, const LineRegisters& registers, u8 firstX, u8 endX)
 {
-	if (m_memory.WY > m_memory.LY)
+	if (registers.WY > line)
 		return;
 
-	u16 characterCodeAreaAddress = (m_memory.LCDC & 0x40) ? 0x9C00 : 0x9800;
+	const std::array<ColorPalette, 8>& bgColorPalettes = m_paletteGenerations[registers.paletteGeneration].bgColorPalettes;
+
+	u16 characterCodeAreaAddress = (registers.LCDC & 0x40) ? 0x9C00 : 0x9800;
 
-	u8 y_window = m_memory.LY - m_memory.WY;
+	u8 y_window = line - registers.WY;
 	u8 characterLine = y_window / CHARACTER_WIDTH;
 	u8 y_character = y_window % CHARACTER_WIDTH;
 
-	u8 windowX = m_memory.WX - 7;
+	u8 windowX = registers.WX - 7;
+	u8 firstWindowX = std::max<u8>(registers.WX > 7 ? windowX : 0, firstX);
 
-	for (u8 x_screen = (m_memory.WX > 7 ? windowX : 0); x_screen < SCREEN_WIDTH; ++x_screen)
+	if (m_backgroundCacheEnabled && (((registers.LCDC ^ m_memory.LCDC) & 0x10) == 0))
+	{
+		u8 mapNumber = (registers.LCDC & 0x40) ? 1 : 0;
+
+		if (firstWindowX < endX)
+			copyBackgroundMapLine(line, registers, mapNumber, y_window, firstWindowX - windowX, firstWindowX, endX);
+
+		return;
+	}
+
+	for (u8 x_screen = firstWindowX; x_screen < endX; ++x_screen)
 	{
 		u8 x_window = x_screen - windowX;
 		u8 characterColumn = x_window / CHARACTER_WIDTH;
@@ -362,61 +917,213 @@ void DisplayController::transferPixelLine_window()
 		u8 colorPaletteNumber = characterAttributes & 0x07;
 		u8 characterDataBankNumber = (characterAttributes & 0x08) >> 3;
 		bool horizontalFlip = characterAttributes & 0x20;
+		bool verticalFlip = characterAttributes & 0x40;
 		bool backgroundPriority = characterAttributes & 0x80;
+		u8 y_data = verticalFlip ? (7 - y_character) : y_character;
 
-		u16 characterDataAddress = (m_memory.LCDC & 0x10) ? (0x8000 + characterCode * CHARACTER_DATA_SIZE) : (0x9000 + (s8)characterCode * CHARACTER_DATA_SIZE);
-		u8 byte0 = m_memory.readDisplayRam(characterDataAddress + y_character * 2, characterDataBankNumber);
-		u8 byte1 = m_memory.readDisplayRam(characterDataAddress + y_character * 2 + 1, characterDataBankNumber);
+		u16 characterDataAddress = (registers.LCDC & 0x10) ? (0x8000 + characterCode * CHARACTER_DATA_SIZE) : (0x9000 + (s8)characterCode * CHARACTER_DATA_SIZE);
+		u8 byte0 = m_memory.readDisplayRam(characterDataAddress + y_data * 2, characterDataBankNumber);
+		u8 byte1 = m_memory.readDisplayRam(characterDataAddress + y_data * 2 + 1, characterDataBankNumber);
 		u8 bitNumber = horizontalFlip ? x_character : 7 - x_character;
 		u8 bit0 = (byte0 >> bitNumber) & 1;
 		u8 bit1 = (byte1 >> bitNumber) & 1;
 		u8 pixel = (bit1 << 1) | bit0;
-		u16 pixelOffset = m_memory.LY * SCREEN_WIDTH + x_screen;
+		u16 pixelOffset = line * SCREEN_WIDTH + x_screen;
 
 		m_frameBuffer[pixelOffset].backgroundValue = pixel;
+		m_frameBuffer[pixelOffset].colorNumber = pixel;
 		m_frameBuffer[pixelOffset].backgroundPriority = backgroundPriority;
-		m_frameBuffer[pixelOffset].dmgColor = (m_memory.BGP >> (pixel * 2)) & 0x03;
-		m_frameBuffer[pixelOffset].cgbColor = m_bgColorPalettes[colorPaletteNumber].color[pixel];
+		m_frameBuffer[pixelOffset].dmgColor = (registers.BGP >> (pixel * 2)) & 0x03;
+		m_frameBuffer[pixelOffset].cgbColor = bgColorPalettes[colorPaletteNumber].color[pixel];
 	}
 }
 
-void DisplayController::drawFrame()
+void DisplayController::updateObjectLines()
 {
-	SDL_Surface* windowSurface = SDL_GetWindowSurface(m_window);
+	m_objectLinesOutdated = false;
+
+	for (ObjectLine& objectLine : m_objectLines)
+		objectLine.objectCount = 0;
 
-	SDL_Rect rect;
-	rect.w = SCREEN_SCALE;
-	rect.h = SCREEN_SCALE;
+	u8 objectHeight = (m_memory.LCDC & 0x04) ? 16 : 8;
 
-	for (u16 pixelOffset = 0; pixelOffset < m_frameBuffer.size(); ++pixelOffset)
+	for (u8 objectNumber = 0; objectNumber < OBJECT_COUNT; ++objectNumber)
 	{
-		rect.x = (pixelOffset % SCREEN_WIDTH) * SCREEN_SCALE;
-		rect.y = (pixelOffset / SCREEN_WIDTH) * SCREEN_SCALE;
+		u16 objectAddress = Memory::OAM_ADDRESS + objectNumber * BYTES_PER_OBJECT;
+
+		Object object;
+		object.y = m_memory.read(objectAddress);
+		object.x = m_memory.read(objectAddress + 1);
+		object.characterCode = m_memory.read(objectAddress + 2);
+		object.attributes = m_memory.read(objectAddress + 3);
+
+		s16 objectY = object.y - MAX_OBJECT_HEIGHT;
+		s16 firstLine = (objectY < 0) ? 0 : objectY;
+		s16 lastLine = (objectY + objectHeight > SCREEN_HEIGHT) ? SCREEN_HEIGHT : objectY + objectHeight;
 
-		u32 color = [&]
+		for (s16 line = firstLine; line < lastLine; ++line)
 		{
-			if (m_cpu.isCgbMode())
-			{
-				Color pixelColor = m_frameBuffer[pixelOffset].cgbColor;
-				u8 red = (u8)((0xFF * pixelColor.red) / 0x1F);
-				u8 green = (u8)((0xFF * pixelColor.green) / 0x1F);
-				u8 blue = (u8)((0xFF * pixelColor.blue) / 0x1F);
-				return SDL_MapRGB(windowSurface->format, red, green, blue);
-			}
-			else
+			ObjectLine& objectLine = m_objectLines[line];
+
+			if (objectLine.objectCount < MAX_OBJECTS_PER_LINE)
 			{
-				switch (m_frameBuffer[pixelOffset].dmgColor)
-				{
-				case 0: return SDL_MapRGB(windowSurface->format, 0xFF, 0xFF, 0xFF); // white
-				case 1: return SDL_MapRGB(windowSurface->format, 0xAA, 0xAA, 0xAA); // light gray
-				case 2: return SDL_MapRGB(windowSurface->format, 0x55, 0x55, 0x55); // dark gray
-				default: return SDL_MapRGB(windowSurface->format, 0, 0, 0); // black
-				}
+				objectLine.objects[objectLine.objectCount] = object;
+				++objectLine.objectCount;
 			}
-		}();
+		}
+	}
+}
+
+void DisplayController::invalidateDisplayRam(u16 address, u8 bankNumber)
+{
+	if (!m_backgroundCacheEnabled)
+		return;
+
+	if (address < 0x9800)
+		++m_characterVersions[(address - Memory::DISPLAYRAM_ADDRESS) / CHARACTER_DATA_SIZE + bankNumber * CHARACTERS_PER_BANK];
+	else
+		m_backgroundMapEntries[(address < 0x9C00) ? 0 : 1][address & 0x03FF].outdated = true;
+}
+
+void DisplayController::updateBackgroundMapLine(u8 mapNumber, u8 y_map)
+{
+	bool characterDataArea = m_memory.LCDC & 0x10;
+	u16 firstEntryNumber = (y_map / CHARACTER_WIDTH) * CHARACTERS_PER_LINE;
+
+	for (u16 entryNumber = firstEntryNumber; entryNumber < firstEntryNumber + CHARACTERS_PER_LINE; ++entryNumber)
+	{
+		const BackgroundMapEntry& entry = m_backgroundMapEntries[mapNumber][entryNumber];
+
+		if (entry.outdated || (entry.characterDataArea != characterDataArea) || (entry.characterVersion != m_characterVersions[entry.characterNumber]))
+			updateBackgroundMapEntry(mapNumber, entryNumber);
+	}
+}
+
+void DisplayController::updateBackgroundMapEntry(u8 mapNumber, u16 entryNumber)
+{
+	u16 characterAddress = (mapNumber ? 0x9C00 : 0x9800) + entryNumber;
+	u8 characterCode = m_memory.readDisplayRam(characterAddress, 0);
+	u8 characterAttributes = m_memory.readDisplayRam(characterAddress, 1);
+
+	u8 colorPaletteNumber = characterAttributes & 0x07;
+	u8 characterDataBankNumber = (characterAttributes & 0x08) >> 3;
+	bool horizontalFlip = characterAttributes & 0x20;
+	bool verticalFlip = characterAttributes & 0x40;
+	bool backgroundPriority = characterAttributes & 0x80;
+
+	bool characterDataArea = m_memory.LCDC & 0x10;
+	u16 characterNumber = (characterDataArea ? characterCode : 256 + (s8)characterCode) + characterDataBankNumber * CHARACTERS_PER_BANK;
+
+	BackgroundMapEntry& entry = m_backgroundMapEntries[mapNumber][entryNumber];
+	entry.outdated = false;
+	entry.characterDataArea = characterDataArea;
+	entry.characterNumber = characterNumber;
+	entry.characterVersion = m_characterVersions[characterNumber];
+
+	u16 characterDataAddress = Memory::DISPLAYRAM_ADDRESS + (characterNumber % CHARACTERS_PER_BANK) * CHARACTER_DATA_SIZE;
+	u8 x_map = (entryNumber % CHARACTERS_PER_LINE) * CHARACTER_WIDTH;
+	u8 y_map = (entryNumber / CHARACTERS_PER_LINE) * CHARACTER_WIDTH;
 
-		SDL_FillRect(windowSurface, &rect, color);
+	// each cached pixel holds its color number (bits 0-1), color palette number (bits 2-4) and background priority (bit 7)
+	u8 pixelAttributes = (colorPaletteNumber << 2) | (backgroundPriority ? 0x80 : 0);
+
+	for (u8 y_character = 0; y_character < CHARACTER_WIDTH; ++y_character)
+	{
+		u8 y_data = verticalFlip ? (7 - y_character) : y_character;
+		u8 byte0 = m_memory.readDisplayRam(characterDataAddress + y_data * 2, characterDataBankNumber);
+		u8 byte1 = m_memory.readDisplayRam(characterDataAddress + y_data * 2 + 1, characterDataBankNumber);
+		u8* mapPixels = &m_backgroundMapPixels[(mapNumber * BACKGROUND_MAP_SIZE + y_map + y_character) * BACKGROUND_MAP_SIZE + x_map];
+
+		for (u8 x_character = 0; x_character < CHARACTER_WIDTH; ++x_character)
+		{
+			u8 bitNumber = horizontalFlip ? x_character : 7 - x_character;
+			u8 bit0 = (byte0 >> bitNumber) & 1;
+			u8 bit1 = (byte1 >> bitNumber) & 1;
+			mapPixels[x_character] = pixelAttributes | (bit1 << 1) | bit0;
+		}
 	}
+}
+
+void DisplayController::copyBackgroundMapLine(u8 line, const LineRegisters& registers, u8 mapNumber, u8 y_map, u8 x_map, u8 x_screen, u8 endX)
+{
+	const std::array<ColorPalette, 8>& bgColorPalettes = m_paletteGenerations[registers.paletteGeneration].bgColorPalettes;
+	const u8* mapPixels = &m_backgroundMapPixels[(mapNumber * BACKGROUND_MAP_SIZE + y_map) * BACKGROUND_MAP_SIZE];
+
+	for (u16 pixelOffset = line * SCREEN_WIDTH + x_screen; x_screen < endX; ++x_screen, ++x_map, ++pixelOffset)
+	{
+		u8 mapPixel = mapPixels[x_map];
+		u8 pixel = mapPixel & 0x03;
+
+		m_frameBuffer[pixelOffset].backgroundValue = pixel;
+		m_frameBuffer[pixelOffset].colorNumber = pixel;
+		m_frameBuffer[pixelOffset].backgroundPriority = mapPixel & 0x80;
+		m_frameBuffer[pixelOffset].dmgColor = (registers.BGP >> (pixel * 2)) & 0x03;
+		m_frameBuffer[pixelOffset].cgbColor = bgColorPalettes[(mapPixel >> 2) & 0x07].color[pixel];
+	}
+}
+
+void DisplayController::drawFrame()
+{
+	// the new frame is compared to the previous one while it is converted
+	u32 changedBits = 0;
+
+	if (m_cpu.isCgbMode())
+	{
+		for (u16 pixelOffset = 0; pixelOffset < m_frameBuffer.size(); ++pixelOffset)
+		{
+			Color pixelColor = m_frameBuffer[pixelOffset].cgbColor;
+			u8 red = (u8)((0xFF * pixelColor.red) / 0x1F);
+			u8 green = (u8)((0xFF * pixelColor.green) / 0x1F);
+			u8 blue = (u8)((0xFF * pixelColor.blue) / 0x1F);
+			u32 color = (red << 16) | (green << 8) | blue;
+			changedBits |= m_frame[pixelOffset] ^ color;
+			m_frame[pixelOffset] = color;
+		}
+	}
+	else
+	{
+		constexpr std::array<u32, 4> DMG_COLORS =
+		{
+			0xFFFFFF, // white
+			0xAAAAAA, // light gray
+			0x555555, // dark gray
+			0x000000 // black
+		};
+
+		for (u16 pixelOffset = 0; pixelOffset < m_frameBuffer.size(); ++pixelOffset)
+		{
+			u32 color = DMG_COLORS[m_frameBuffer[pixelOffset].dmgColor];
+			changedBits |= m_frame[pixelOffset] ^ color;
+			m_frame[pixelOffset] = color;
+		}
+	}
+
+	if (m_skipIdenticalFrames && m_frameDrawn && (changedBits == 0))
+	{
+		++m_repeatedFrameCount;
+
+		for (const std::unique_ptr<FrameSink>& frameSink : m_frameSinks)
+			frameSink->repeatFrame();
+
+		return;
+	}
+
+	for (const std::unique_ptr<FrameSink>& frameSink : m_frameSinks)
+		frameSink->drawFrame(m_frame);
+
+	m_frameDrawn = true;
+}
+
+void DisplayController::updateFrameSkip()
+{
+	constexpr u8 MAX_ADAPTIVE_FRAME_SKIP = 4;
+
+	if (!m_frameSinkEnabled && !m_observationsEnabled)
+		m_skipFrame = true;
+	else if (m_adaptiveFrameSkip)
+		m_skipFrame = m_late && (m_skippedFrameCount < MAX_ADAPTIVE_FRAME_SKIP);
+	else
+		m_skipFrame = m_skippedFrameCount < m_frameSkip;
 
-	SDL_UpdateWindowSurface(m_window);
+	m_skippedFrameCount = m_skipFrame ? m_skippedFrameCount + 1 : 0;
 }
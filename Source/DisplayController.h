@@ -20,21 +20,50 @@ along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <array>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
 
 #include "Types.h"
+#include "FrameSink.h"
+#include "WorkerPool.h"
 
 class Memory;
 class Cpu;
-struct SDL_Window;
+class Scheduler;
+class CaptureFrameSink;
+struct Settings;
 
 class DisplayController
 {
 public:
-	DisplayController(Memory& memory, Cpu& cpu);
+	DisplayController(Memory& memory, Cpu& cpu, Scheduler& scheduler, const Settings& settings);
 	~DisplayController();
 
-	void doCycle();
+	void regulateFramerate();
+	void synchronize(u16 address);
 	void writeToLCDC(u8 value);
+	void writeToSTAT(u8 value);
+	void writeToLineRegister(u16 address, u8 value);
+	void writeToHDMA5(u8 value);
+	void writeToDisplayRam(u16 address, u8 value);
+	void writeToOam(u16 address, u8 value);
+	void performDmaTransfer();
+	void performHdmaTransfer(u8 n);
+
+	// called in a loop by the main thread while the emulation runs on another one, waits for the next frame
+	void presentFrames();
+	FrameSink& getFrameSink();
+	u32 getFrameCount();
+
+	// observations are read from the last frame without converting it to RGB, rendering continues even if no frame sink is enabled
+	void enableObservations();
+	// 2 bits per pixel, 4 pixels per byte starting from the low bits: the shade on DMG, the color number on CGB
+	void readColorIndices(u8* buffer);
+	// 1 byte per pixel, the screen is box-filtered down to width x height, from 1 x 1 to 160 x 144
+	void readLuminance(u8* buffer, u8 width, u8 height);
+	void requestScreenshot();
 
 	u8 readBgPaletteColor();
 	u8 readObjPaletteColor();
@@ -50,6 +79,25 @@ private:
 		SCREEN_HEIGHT = 144
 	};
 
+	enum
+	{
+		OBJECT_COUNT = 40,
+		MAX_OBJECTS_PER_LINE = 10
+	};
+
+	enum
+	{
+		BACKGROUND_MAP_COUNT = 2,
+		BACKGROUND_MAP_SIZE = 256,
+		BACKGROUND_MAP_ENTRY_COUNT = 32 * 32,
+		CHARACTERS_PER_BANK = 384
+	};
+
+	enum
+	{
+		PIXELTRANSFER_CYCLES = 43
+	};
+
 	enum ModeFlag : u8
 	{
 		HBLANK_MODE_FLAG = 0,
@@ -76,26 +124,125 @@ private:
 	{
 		u8 backgroundValue = 0;
 		bool backgroundPriority = false;
+		u8 colorNumber = 0;
 		u8 dmgColor = 0;
 		Color cgbColor{};
 	};
 
+	struct Object
+	{
+		u8 y, x, characterCode, attributes;
+	};
+
+	struct ObjectLine
+	{
+		u8 objectCount = 0;
+		std::array<Object, MAX_OBJECTS_PER_LINE> objects;
+	};
+
+	// registers read by the rendering of a line, recorded when its pixel transfer starts
+	struct LineRegisters
+	{
+		u8 LCDC, SCY, SCX, WY, WX, BGP, OBP0, OBP1;
+		u16 paletteGeneration;
+	};
+
+	// registers written during the pixel transfer of a line, used from pixel firstX
+	struct LineSegment
+	{
+		u8 firstX;
+		LineRegisters registers;
+	};
+
+	struct PaletteGeneration
+	{
+		std::array<ColorPalette, 8> bgColorPalettes;
+		std::array<ColorPalette, 8> objColorPalettes;
+	};
+
+	struct BackgroundMapEntry
+	{
+		bool outdated = true;
+		bool characterDataArea = false;
+		u16 characterNumber = 0;
+		u32 characterVersion = 0;
+	};
+
+	void synchronize();
+	void scheduleNextEvent();
+	void updateMode();
 	void updateLY(u8 value);
-	void changeMode(ModeFlag flag);
+	void changeMode(ModeFlag flag, u8 cycleCount);
 
 	void transferPixelLine();
-	void transferPixelLine_background();
-	void transferPixelLine_objects();
-	void transferPixelLine_window();
+	void splitPixelLine();
+	u8 getPixelAtDot(u16 dot);
+	LineRegisters getLineRegisters();
+	void renderPendingLines();
+	void prepareLineSegment(u8 line, const LineRegisters& registers);
+	void renderLine(u8 line);
+	void renderLineSegment(u8 line, const LineRegisters& registers, u8 firstX, u8 endX);
+	void renderLine_background(u8 line, const LineRegisters& registers, u8 firstX, u8 endX);
+	void renderLine_objects(u8 line, const LineRegisters& registers, u8 firstX, u8 endX);
+	void renderLine_window(u8 line, const LineRegisters& registers, u8 firstX, u8 endX);
+
+	void updateObjectLines();
+
+	void invalidateDisplayRam(u16 address, u8 bankNumber);
+	void updateBackgroundMapLine(u8 mapNumber, u8 y_map);
+	void updateBackgroundMapEntry(u8 mapNumber, u16 entryNumber);
+	void copyBackgroundMapLine(u8 line, const LineRegisters& registers, u8 mapNumber, u8 y_map, u8 x_map, u8 x_screen, u8 endX);
 
 	void drawFrame();
+	void updateFrameSkip();
+	void createCaptureFrameSink(u32 captureInterval);
 
 	Memory& m_memory;
 	Cpu& m_cpu;
-	
-	u8 m_cycleCounter = 0;
+	Scheduler& m_scheduler;
+
+	bool m_lazyDisplay;
+	u64 m_nextModeCycle = 0;
 	std::array<Pixel, SCREEN_HEIGHT * SCREEN_WIDTH> m_frameBuffer;
-	SDL_Window* m_window;
+	FrameSink::Frame m_frame;
+	std::vector<std::unique_ptr<FrameSink>> m_frameSinks;
+	FrameSink* m_videoFrameSink;
+	bool m_frameSinkEnabled = false;
+	bool m_observationsEnabled = false;
+	CaptureFrameSink* m_captureFrameSink = nullptr;
+	std::string m_capturePrefix;
+
+	bool m_deferredRendering;
+	std::unique_ptr<WorkerPool> m_workerPool;
+	std::array<LineRegisters, SCREEN_HEIGHT> m_lineRegisters;
+	std::array<std::vector<LineSegment>, SCREEN_HEIGHT> m_lineSegments;
+	u8 m_firstPendingLine = 0;
+	u8 m_pendingLineCount = 0;
+	std::vector<PaletteGeneration> m_paletteGenerations;
+	bool m_palettesChanged = true;
+
+	std::array<ObjectLine, SCREEN_HEIGHT> m_objectLines;
+	bool m_objectLinesOutdated = true;
+
+	bool m_backgroundCacheEnabled;
+	std::array<std::array<BackgroundMapEntry, BACKGROUND_MAP_ENTRY_COUNT>, BACKGROUND_MAP_COUNT> m_backgroundMapEntries;
+	std::vector<u8> m_backgroundMapPixels;
+	std::array<u32, 2 * CHARACTERS_PER_BANK> m_characterVersions{};
+
+	bool m_skipIdenticalFrames;
+	bool m_frameDrawn = false;
+	u32 m_repeatedFrameCount = 0;
+
+	u8 m_frameSkip;
+	bool m_adaptiveFrameSkip;
+	bool m_skipFrame = false;
+	u8 m_skippedFrameCount = 0;
+
+	bool m_uncappedSpeed;
+	bool m_audioSync;
+	bool m_late = false;
+	u32 m_frameCounter = 0;
+	std::chrono::steady_clock::time_point m_startTime;
 
 	std::array<ColorPalette, 8> m_bgColorPalettes;
 	std::array<ColorPalette, 8> m_objColorPalettes;
@@ -0,0 +1,113 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+#include "Error.h"
+#include "DumpFrameSink.h"
+
+constexpr u16 QUEUE_CAPACITY = 64;
+
+DumpFrameSink::DumpFrameSink(const std::string& filename, Format format, bool printThroughput) :
+	m_file(filename, std::ios::binary),
+	m_format(format),
+	m_printThroughput(printThroughput),
+	m_buffer(FRAME_WIDTH * FRAME_HEIGHT * 3),
+	m_frames(QUEUE_CAPACITY),
+	m_startTime(std::chrono::steady_clock::now())
+{
+	if (!m_file)
+		throwError("Failed to open ", filename);
+
+	// 4194304 / 70224 = 59.73 frames per second
+	if (m_format == Y4M_FORMAT)
+		m_file << "YUV4MPEG2 W" << (int)FRAME_WIDTH << " H" << (int)FRAME_HEIGHT << " F4194304:70224 Ip A1:1 C444\n";
+
+	m_thread = std::thread(&DumpFrameSink::write, this);
+}
+
+DumpFrameSink::~DumpFrameSink()
+{
+	m_frames.close();
+	m_thread.join();
+
+	if (!m_printThroughput)
+		return;
+
+	std::chrono::duration<double> elapsedTime = std::chrono::steady_clock::now() - m_startTime;
+	double megabytes = (double)m_frameCount * m_buffer.size() / (1024 * 1024);
+	std::cout << m_frameCount << " frames dumped (" << megabytes / elapsedTime.count() << " MB/s), the emulation waited " << m_frames.getFullCount() << " times on the writer" << std::endl;
+}
+
+void DumpFrameSink::drawFrame(const Frame& frame)
+{
+	m_lastFrame = frame;
+	m_frames.push(frame);
+}
+
+void DumpFrameSink::repeatFrame()
+{
+	m_frames.push(m_lastFrame);
+}
+
+void DumpFrameSink::write()
+{
+	Frame frame;
+
+	while (m_frames.pop(frame))
+	{
+		writeFrame(frame);
+		++m_frameCount;
+	}
+
+	m_file.flush();
+}
+
+void DumpFrameSink::writeFrame(const Frame& frame)
+{
+	constexpr u16 PLANE_SIZE = FRAME_WIDTH * FRAME_HEIGHT;
+
+	if (m_format == Y4M_FORMAT)
+	{
+		// BT.601 studio range, each plane at full resolution
+		for (u16 pixelOffset = 0; pixelOffset < PLANE_SIZE; ++pixelOffset)
+		{
+			s32 red = (frame[pixelOffset] >> 16) & 0xFF;
+			s32 green = (frame[pixelOffset] >> 8) & 0xFF;
+			s32 blue = frame[pixelOffset] & 0xFF;
+
+			m_buffer[pixelOffset] = (u8)(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+			m_buffer[PLANE_SIZE + pixelOffset] = (u8)(((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+			m_buffer[2 * PLANE_SIZE + pixelOffset] = (u8)(((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+		}
+
+		m_file << "FRAME\n";
+	}
+	else
+	{
+		for (u16 pixelOffset = 0; pixelOffset < PLANE_SIZE; ++pixelOffset)
+		{
+			m_buffer[pixelOffset * 3] = (u8)(frame[pixelOffset] >> 16);
+			m_buffer[pixelOffset * 3 + 1] = (u8)(frame[pixelOffset] >> 8);
+			m_buffer[pixelOffset * 3 + 2] = (u8)frame[pixelOffset];
+		}
+	}
+
+	m_file.write((const char*)m_buffer.data(), m_buffer.size());
+}
@@ -0,0 +1,60 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+#include "FrameSink.h"
+#include "FrameQueue.h"
+
+// writes every frame to a file or named pipe, as YUV4MPEG2 (4:4:4) or raw RGB24, on a writer thread
+class DumpFrameSink : public FrameSink
+{
+public:
+	enum Format
+	{
+		Y4M_FORMAT, RGB_FORMAT
+	};
+
+	// the throughput is only printed when the speed is uncapped, otherwise it's the emulation speed
+	DumpFrameSink(const std::string& filename, Format format, bool printThroughput);
+	~DumpFrameSink();
+
+	void drawFrame(const Frame& frame) override;
+	void repeatFrame() override;
+
+private:
+	void write();
+	void writeFrame(const Frame& frame);
+
+	std::ofstream m_file;
+	Format m_format;
+	bool m_printThroughput;
+	std::vector<u8> m_buffer;
+
+	FrameQueue m_frames;
+	Frame m_lastFrame{};
+	u32 m_frameCount = 0;
+	std::chrono::steady_clock::time_point m_startTime;
+	std::thread m_thread;
+};
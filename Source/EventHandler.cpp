@@ -20,32 +20,17 @@ along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 #include <SDL.h>
 
 #include "EventHandler.h"
-#include "DisplayController.h"
 
 void EventHandler::updateP1(u8& P1)
 {
-	const u8* keyboardState = SDL_GetKeyboardState(nullptr);
+	u8 buttons = m_buttons.load(std::memory_order_relaxed);
 
 	P1 |= 0x0F; // input ports reset
 
 	if ((P1 & 0x10) == 0)
-	{
-		u8 right = keyboardState[SDL_SCANCODE_RIGHT];
-		u8 left = keyboardState[SDL_SCANCODE_LEFT];
-		u8 up = keyboardState[SDL_SCANCODE_UP];
-		u8 down = keyboardState[SDL_SCANCODE_DOWN];
-
-		P1 ^= (down << 3) | (up << 2) | (left << 1) | right;
-	}
+		P1 ^= buttons & 0x0F;
 	else if ((P1 & 0x20) == 0)
-	{
-		u8 a = keyboardState[SDL_SCANCODE_Q];
-		u8 b = keyboardState[SDL_SCANCODE_W];
-		u8 select = keyboardState[SDL_SCANCODE_SPACE];
-		u8 start = keyboardState[SDL_SCANCODE_RETURN];
-
-		P1 ^= (start << 3) | (select << 2) | (b << 1) | a;
-	}
+		P1 ^= buttons >> 4;
 }
 
 bool EventHandler::isQuitRequested()
@@ -53,21 +38,40 @@ bool EventHandler::isQuitRequested()
 	return m_quitRequested;
 }
 
-void EventHandler::doCycle()
+void EventHandler::requestQuit()
 {
-	static u16 cycleCounter = 0;
-	++cycleCounter;
+	m_quitRequested = true;
+}
 
-	if (cycleCounter == DisplayController::CYCLES_PER_FRAME)
-	{
-		cycleCounter = 0;
+bool EventHandler::takeScreenshotRequest()
+{
+	return m_screenshotRequested.exchange(false);
+}
 
-		SDL_Event event;
+void EventHandler::pollEvents()
+{
+	SDL_Event event;
 
-		while (SDL_PollEvent(&event))
-		{
-			if (event.type == SDL_QUIT)
-				m_quitRequested = true;
-		}
+	while (SDL_PollEvent(&event))
+	{
+		if (event.type == SDL_QUIT)
+			m_quitRequested = true;
+		else if ((event.type == SDL_KEYDOWN) && (event.key.keysym.scancode == SDL_SCANCODE_F12) && !event.key.repeat)
+			m_screenshotRequested = true;
 	}
+
+	// the keyboard state is only updated by the polling, the emulation reads this copy
+	const u8* keyboardState = SDL_GetKeyboardState(nullptr);
+
+	u8 right = keyboardState[SDL_SCANCODE_RIGHT];
+	u8 left = keyboardState[SDL_SCANCODE_LEFT];
+	u8 up = keyboardState[SDL_SCANCODE_UP];
+	u8 down = keyboardState[SDL_SCANCODE_DOWN];
+
+	u8 a = keyboardState[SDL_SCANCODE_Q];
+	u8 b = keyboardState[SDL_SCANCODE_W];
+	u8 select = keyboardState[SDL_SCANCODE_SPACE];
+	u8 start = keyboardState[SDL_SCANCODE_RETURN];
+
+	m_buttons.store((start << 7) | (select << 6) | (b << 5) | (a << 4) | (down << 3) | (up << 2) | (left << 1) | right, std::memory_order_relaxed);
 }
@@ -19,16 +19,25 @@ along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <atomic>
+
 #include "Types.h"
 
+// the events are polled by the thread that owns the window, the emulation may run on another one
 class EventHandler
 {
 public:
-	static void updateP1(u8& P1);
-	
-	void doCycle();
+	void updateP1(u8& P1);
+
+	void pollEvents();
 	bool isQuitRequested();
+	void requestQuit();
+	bool takeScreenshotRequest();
 
 private:
-	bool m_quitRequested = false;
+	std::atomic<bool> m_quitRequested{false};
+	std::atomic<bool> m_screenshotRequested{false};
+
+	// state of the keys when the events were last polled, the directions in the low nibble
+	std::atomic<u8> m_buttons{0};
 };
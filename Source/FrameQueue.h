@@ -0,0 +1,123 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "FrameSink.h"
+
+// bounded queue of frames between the emulation and a consumer thread
+class FrameQueue
+{
+public:
+	explicit FrameQueue(u16 capacity) : m_frames(capacity)
+	{
+	}
+
+	// blocks while the queue is full, the frame number is passed along for the consumer
+	void push(const FrameSink::Frame& frame, u32 frameNumber = 0)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_frameCount == m_frames.size())
+		{
+			++m_fullCount;
+			m_notFullCondition.wait(lock, [this] { return m_frameCount < m_frames.size(); });
+		}
+
+		Entry& entry = m_frames[(m_firstFrame + m_frameCount) % m_frames.size()];
+		entry.frame = frame;
+		entry.frameNumber = frameNumber;
+		++m_frameCount;
+		m_notEmptyCondition.notify_one();
+	}
+
+	// returns false instead of waiting when the queue is full
+	bool tryPush(const FrameSink::Frame& frame, u32 frameNumber = 0)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_frameCount == m_frames.size())
+			return false;
+
+		Entry& entry = m_frames[(m_firstFrame + m_frameCount) % m_frames.size()];
+		entry.frame = frame;
+		entry.frameNumber = frameNumber;
+		++m_frameCount;
+		m_notEmptyCondition.notify_one();
+		return true;
+	}
+
+	// blocks until a frame is available, returns false once the queue is closed and empty
+	bool pop(FrameSink::Frame& frame)
+	{
+		u32 frameNumber;
+		return pop(frame, frameNumber);
+	}
+
+	bool pop(FrameSink::Frame& frame, u32& frameNumber)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmptyCondition.wait(lock, [this] { return (m_frameCount > 0) || m_closed; });
+
+		if (m_frameCount == 0)
+			return false;
+
+		frame = m_frames[m_firstFrame].frame;
+		frameNumber = m_frames[m_firstFrame].frameNumber;
+		m_firstFrame = (m_firstFrame + 1) % m_frames.size();
+		--m_frameCount;
+		m_notFullCondition.notify_one();
+		return true;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmptyCondition.notify_one();
+	}
+
+	// number of times push had to wait for the consumer
+	u32 getFullCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_fullCount;
+	}
+
+private:
+	struct Entry
+	{
+		FrameSink::Frame frame;
+		u32 frameNumber;
+	};
+
+	std::vector<Entry> m_frames;
+	size_t m_firstFrame = 0;
+	size_t m_frameCount = 0;
+	u32 m_fullCount = 0;
+	bool m_closed = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_notEmptyCondition;
+	std::condition_variable m_notFullCondition;
+};
@@ -0,0 +1,68 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FrameSink.h"
+
+bool FrameSink::isEnabled()
+{
+	return true;
+}
+
+void FrameSink::repeatFrame()
+{
+}
+
+void FrameSink::skipFrame()
+{
+	repeatFrame();
+}
+
+void FrameSink::present()
+{
+}
+
+bool NullFrameSink::isEnabled()
+{
+	return false;
+}
+
+void NullFrameSink::drawFrame(const Frame&)
+{
+}
+
+void BufferFrameSink::drawFrame(const Frame& frame)
+{
+	m_frame = frame;
+	++m_frameCount;
+}
+
+void BufferFrameSink::repeatFrame()
+{
+	++m_frameCount;
+}
+
+const FrameSink::Frame& BufferFrameSink::getFrame()
+{
+	return m_frame;
+}
+
+u32 BufferFrameSink::getFrameCount()
+{
+	return m_frameCount;
+}
@@ -0,0 +1,71 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+
+#include "Types.h"
+
+class FrameSink
+{
+public:
+	enum : u8
+	{
+		FRAME_WIDTH = 160,
+		FRAME_HEIGHT = 144
+	};
+
+	// pixels are stored as 0x00RRGGBB
+	using Frame = std::array<u32, FRAME_WIDTH * FRAME_HEIGHT>;
+
+	virtual ~FrameSink() = default;
+
+	virtual bool isEnabled();
+	virtual void drawFrame(const Frame& frame) = 0;
+
+	// called instead of drawFrame when the frame is identical to the previous one
+	virtual void repeatFrame();
+	// called instead of drawFrame when the frame wasn't rendered, repeats the previous one by default
+	virtual void skipFrame();
+
+	// called in a loop by the main thread when the emulation runs on another thread, may wait for the next frame
+	virtual void present();
+};
+
+class NullFrameSink : public FrameSink
+{
+public:
+	bool isEnabled() override;
+	void drawFrame(const Frame& frame) override;
+};
+
+class BufferFrameSink : public FrameSink
+{
+public:
+	void drawFrame(const Frame& frame) override;
+	void repeatFrame() override;
+
+	const Frame& getFrame();
+	u32 getFrameCount();
+
+private:
+	Frame m_frame{};
+	u32 m_frameCount = 0;
+};
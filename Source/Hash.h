@@ -0,0 +1,37 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Types.h"
+
+constexpr u64 HASH_OFFSET_BASIS = 0xCBF29CE484222325;
+constexpr u64 HASH_PRIME = 0x100000001B3;
+
+// FNV-1a, one 32-bit pixel at a time instead of one byte at a time
+inline u64 hashPixels(const u32* pixels, size_t pixelCount, u64 hash = HASH_OFFSET_BASIS)
+{
+	for (size_t pixelNumber = 0; pixelNumber < pixelCount; ++pixelNumber)
+	{
+		hash ^= pixels[pixelNumber];
+		hash *= HASH_PRIME;
+	}
+
+	return hash;
+}
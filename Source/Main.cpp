@@ -19,16 +19,24 @@ along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Memory.h"
 #include "Cpu.h"
-#include "Error.h"
+#include "Settings.h"
+#include "ChecksumLog.h"
+#include "ObservationLog.h"
 
 int main(int argumentCount, char* arguments[])
 {
-	if (argumentCount < 2)
-		throwError("Usage: CppGB.exe <rom>");
-	
-	Memory memory(arguments[1]);
-	Cpu cpu(memory);
-	cpu.run();
+	Settings settings = parseSettings(argumentCount, arguments);
+
+	if (!settings.comparedChecksumLogs[0].empty())
+		return compareChecksumLogs(settings.comparedChecksumLogs[0], settings.comparedChecksumLogs[1]) ? 0 : 1;
+
+	Memory memory(settings.romFilename);
+	Cpu cpu(memory, settings);
+
+	if (settings.observationFilename.empty())
+		cpu.run();
+	else
+		writeObservations(cpu, settings);
 
 	return 0;
 }
@@ -105,7 +105,12 @@ public:
 	u8 readDisplayRam(u16 address, u8 bankNumber);
 	void write(u16 address, u8 value);
 
+	static constexpr u16 DISPLAYRAM_ADDRESS = 0x8000;
+	static constexpr u16 DISPLAYRAM_SIZE = 0x2000;
 	static constexpr u16 OAM_ADDRESS = 0xFE00;
+	static constexpr u16 OAM_SIZE = 160;
+	static constexpr u16 WAVEFORMRAM_ADDRESS = 0xFF30;
+	static constexpr u16 WAVEFORMRAM_SIZE = 16;
 
 	u8 P1{};
 	u8 SB{}, SC{};
@@ -158,7 +163,7 @@ private:
 	std::vector<u8> m_externalRam;
 	std::array<u8, 0x4000> m_displayRam{};
 	std::array<u8, 0x8000> m_workRam{};
-	std::array<u8, 160> m_oam{};
+	std::array<u8, OAM_SIZE> m_oam{};
 	std::array<u8, 127> m_stackRam{};
 	std::array<u8, 32> m_waveformRam{};
 };
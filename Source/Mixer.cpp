@@ -0,0 +1,99 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "Mixer.h"
+#include "Sse2.h"
+
+constexpr u8 Mixer::CHANNEL_COUNT;
+
+// gains go up to 8, four channels at full volume stay within 16 bits
+constexpr u8 OUTPUT_SHIFT = 3;
+
+s16 clampSample(s32 value)
+{
+	return (s16)std::min(std::max(value, -32768), 32767);
+}
+
+void Mixer::setVolumes(u8 NR50, u8 NR51)
+{
+	// SO2 is the left terminal, SO1 the right one
+	s16 leftVolume = ((NR50 >> 4) & 0x07) + 1;
+	s16 rightVolume = (NR50 & 0x07) + 1;
+
+	for (u8 channelNumber = 0; channelNumber < CHANNEL_COUNT; ++channelNumber)
+	{
+		m_leftGains[channelNumber] = (NR51 & (0x10 << channelNumber)) ? leftVolume : 0;
+		m_rightGains[channelNumber] = (NR51 & (0x01 << channelNumber)) ? rightVolume : 0;
+	}
+}
+
+void Mixer::mix(const std::array<const s16*, CHANNEL_COUNT>& channelSamples, StereoSample* output, u16 sampleCount)
+{
+	u16 n = 0;
+
+#ifdef HAS_SSE2
+	// each 32-bit lane holds the gains of a pair of channels, for the multiply-add of interleaved samples
+	auto setGainPair = [](s16 gain0, s16 gain1) { return _mm_set1_epi32((u16)gain0 | (gain1 << 16)); };
+	__m128i leftGains01 = setGainPair(m_leftGains[0], m_leftGains[1]);
+	__m128i leftGains23 = setGainPair(m_leftGains[2], m_leftGains[3]);
+	__m128i rightGains01 = setGainPair(m_rightGains[0], m_rightGains[1]);
+	__m128i rightGains23 = setGainPair(m_rightGains[2], m_rightGains[3]);
+
+	for (; n + 8 <= sampleCount; n += 8)
+	{
+		__m128i samples0 = _mm_loadu_si128((const __m128i*)&channelSamples[0][n]);
+		__m128i samples1 = _mm_loadu_si128((const __m128i*)&channelSamples[1][n]);
+		__m128i samples2 = _mm_loadu_si128((const __m128i*)&channelSamples[2][n]);
+		__m128i samples3 = _mm_loadu_si128((const __m128i*)&channelSamples[3][n]);
+
+		__m128i samples01Low = _mm_unpacklo_epi16(samples0, samples1);
+		__m128i samples01High = _mm_unpackhi_epi16(samples0, samples1);
+		__m128i samples23Low = _mm_unpacklo_epi16(samples2, samples3);
+		__m128i samples23High = _mm_unpackhi_epi16(samples2, samples3);
+
+		__m128i leftLow = _mm_add_epi32(_mm_madd_epi16(samples01Low, leftGains01), _mm_madd_epi16(samples23Low, leftGains23));
+		__m128i leftHigh = _mm_add_epi32(_mm_madd_epi16(samples01High, leftGains01), _mm_madd_epi16(samples23High, leftGains23));
+		__m128i rightLow = _mm_add_epi32(_mm_madd_epi16(samples01Low, rightGains01), _mm_madd_epi16(samples23Low, rightGains23));
+		__m128i rightHigh = _mm_add_epi32(_mm_madd_epi16(samples01High, rightGains01), _mm_madd_epi16(samples23High, rightGains23));
+
+		__m128i left = _mm_packs_epi32(_mm_srai_epi32(leftLow, OUTPUT_SHIFT), _mm_srai_epi32(leftHigh, OUTPUT_SHIFT));
+		__m128i right = _mm_packs_epi32(_mm_srai_epi32(rightLow, OUTPUT_SHIFT), _mm_srai_epi32(rightHigh, OUTPUT_SHIFT));
+
+		_mm_storeu_si128((__m128i*)&output[n], _mm_unpacklo_epi16(left, right));
+		_mm_storeu_si128((__m128i*)&output[n + 4], _mm_unpackhi_epi16(left, right));
+	}
+#endif
+
+	for (; n < sampleCount; ++n)
+	{
+		s32 left = 0;
+		s32 right = 0;
+
+		for (u8 channelNumber = 0; channelNumber < CHANNEL_COUNT; ++channelNumber)
+		{
+			left += channelSamples[channelNumber][n] * m_leftGains[channelNumber];
+			right += channelSamples[channelNumber][n] * m_rightGains[channelNumber];
+		}
+
+		output[n].left = clampSample(left >> OUTPUT_SHIFT);
+		output[n].right = clampSample(right >> OUTPUT_SHIFT);
+	}
+}
@@ -0,0 +1,44 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+
+#include "Types.h"
+
+struct StereoSample
+{
+	s16 left;
+	s16 right;
+};
+
+// sums the channel buffers into interleaved stereo samples, routed by NR51 and scaled by the NR50 volumes
+class Mixer
+{
+public:
+	static constexpr u8 CHANNEL_COUNT = 4;
+
+	void setVolumes(u8 NR50, u8 NR51);
+	void mix(const std::array<const s16*, CHANNEL_COUNT>& channelSamples, StereoSample* output, u16 sampleCount);
+
+private:
+	std::array<s16, CHANNEL_COUNT> m_leftGains{};
+	std::array<s16, CHANNEL_COUNT> m_rightGains{};
+};
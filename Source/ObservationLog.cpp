@@ -0,0 +1,50 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <vector>
+
+#include "Error.h"
+#include "Cpu.h"
+#include "Settings.h"
+#include "ObservationLog.h"
+
+void writeObservations(Cpu& cpu, const Settings& settings)
+{
+	std::ofstream file(settings.observationFilename, std::ios::binary);
+
+	if (!file)
+		throwError("Failed to open ", settings.observationFilename);
+
+	DisplayController& displayController = cpu.getDisplayController();
+	displayController.enableObservations();
+
+	bool colorIndices = settings.observationFormat == Settings::INDEX_OBSERVATION;
+	std::vector<u8> observation(colorIndices ? FrameSink::FRAME_WIDTH * FrameSink::FRAME_HEIGHT / 4 : settings.observationWidth * settings.observationHeight);
+
+	while (cpu.runFrame())
+	{
+		if (colorIndices)
+			displayController.readColorIndices(observation.data());
+		else
+			displayController.readLuminance(observation.data(), settings.observationWidth, settings.observationHeight);
+
+		file.write((const char*)observation.data(), observation.size());
+	}
+}
@@ -0,0 +1,330 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <array>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "PngWriter.h"
+
+std::array<u32, 256> createCrcTable()
+{
+	std::array<u32, 256> crcTable;
+
+	for (u32 n = 0; n < 256; ++n)
+	{
+		u32 crc = n;
+
+		for (u8 bitNumber = 0; bitNumber < 8; ++bitNumber)
+			crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+
+		crcTable[n] = crc;
+	}
+
+	return crcTable;
+}
+
+u32 computeCrc(const u8* data, size_t size, u32 crc = 0)
+{
+	static const std::array<u32, 256> CRC_TABLE = createCrcTable();
+
+	crc = ~crc;
+
+	for (size_t offset = 0; offset < size; ++offset)
+		crc = CRC_TABLE[(crc ^ data[offset]) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+void append_u32(std::vector<u8>& data, u32 value)
+{
+	data.push_back((u8)(value >> 24));
+	data.push_back((u8)(value >> 16));
+	data.push_back((u8)(value >> 8));
+	data.push_back((u8)value);
+}
+
+void appendChunk(std::vector<u8>& png, const char* type, const std::vector<u8>& data)
+{
+	append_u32(png, (u32)data.size());
+	size_t typeOffset = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	append_u32(png, computeCrc(&png[typeOffset], 4 + data.size()));
+}
+
+// deflate writes its bits from the least significant one, Huffman codes from their most significant bit
+class BitWriter
+{
+public:
+	BitWriter(std::vector<u8>& data) : m_data(data)
+	{
+	}
+
+	void writeBits(u32 bits, u8 bitCount)
+	{
+		m_bitBuffer |= bits << m_bitCount;
+		m_bitCount += bitCount;
+
+		for (; m_bitCount >= 8; m_bitCount -= 8)
+		{
+			m_data.push_back((u8)m_bitBuffer);
+			m_bitBuffer >>= 8;
+		}
+	}
+
+	void writeCode(u16 code, u8 bitCount)
+	{
+		u16 reversedCode = 0;
+
+		for (u8 bitNumber = 0; bitNumber < bitCount; ++bitNumber)
+			reversedCode |= ((code >> bitNumber) & 1) << (bitCount - 1 - bitNumber);
+
+		writeBits(reversedCode, bitCount);
+	}
+
+	void flush()
+	{
+		if (m_bitCount > 0)
+			m_data.push_back((u8)m_bitBuffer);
+
+		m_bitBuffer = 0;
+		m_bitCount = 0;
+	}
+
+private:
+	std::vector<u8>& m_data;
+	u32 m_bitBuffer = 0;
+	u8 m_bitCount = 0;
+};
+
+// literal and length symbols with the fixed Huffman codes of deflate
+void writeSymbol(BitWriter& bitWriter, u16 symbol)
+{
+	if (symbol < 144)
+		bitWriter.writeCode(0x30 + symbol, 8);
+	else if (symbol < 256)
+		bitWriter.writeCode(0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		bitWriter.writeCode(symbol - 256, 7);
+	else
+		bitWriter.writeCode(0xC0 + symbol - 280, 8);
+}
+
+void writeMatch(BitWriter& bitWriter, u16 length, u16 distance)
+{
+	static constexpr std::array<u16, 29> LENGTH_BASES = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static constexpr std::array<u8, 29> LENGTH_EXTRA_BITS = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr std::array<u16, 30> DISTANCE_BASES = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static constexpr std::array<u8, 30> DISTANCE_EXTRA_BITS = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	u8 lengthCode = (u8)(std::upper_bound(LENGTH_BASES.begin(), LENGTH_BASES.end(), length) - LENGTH_BASES.begin() - 1);
+	writeSymbol(bitWriter, 257 + lengthCode);
+	bitWriter.writeBits(length - LENGTH_BASES[lengthCode], LENGTH_EXTRA_BITS[lengthCode]);
+
+	u8 distanceCode = (u8)(std::upper_bound(DISTANCE_BASES.begin(), DISTANCE_BASES.end(), distance) - DISTANCE_BASES.begin() - 1);
+	bitWriter.writeCode(distanceCode, 5);
+	bitWriter.writeBits(distance - DISTANCE_BASES[distanceCode], DISTANCE_EXTRA_BITS[distanceCode]);
+}
+
+// a single block with the fixed Huffman codes, the matches are found greedily through hash chains of 3-byte sequences.
+// Game Boy frames are mostly flat areas and repeated tiles, which this already reduces more than tenfold
+void deflate(const std::vector<u8>& input, std::vector<u8>& output)
+{
+	constexpr u8 MIN_MATCH_LENGTH = 3;
+	constexpr u16 MAX_MATCH_LENGTH = 258;
+	constexpr u16 WINDOW_SIZE = 32768;
+	constexpr u8 HASH_BITS = 15;
+	constexpr u8 MAX_CHAIN_LENGTH = 32;
+	constexpr s32 NO_POSITION = -1;
+
+	std::vector<s32> hashHeads(1 << HASH_BITS, NO_POSITION);
+	std::vector<s32> previousPositions(input.size(), NO_POSITION);
+
+	auto getHash = [&](size_t position)
+	{
+		u32 sequence = input[position] | (input[position + 1] << 8) | (input[position + 2] << 16);
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	};
+
+	auto insertPosition = [&](size_t position)
+	{
+		if (position + MIN_MATCH_LENGTH > input.size())
+			return;
+
+		u32 hash = getHash(position);
+		previousPositions[position] = hashHeads[hash];
+		hashHeads[hash] = (s32)position;
+	};
+
+	BitWriter bitWriter(output);
+	bitWriter.writeBits(1, 1); // last block
+	bitWriter.writeBits(1, 2); // fixed Huffman codes
+
+	for (size_t position = 0; position < input.size();)
+	{
+		u16 bestLength = 0;
+		u16 bestDistance = 0;
+
+		if (position + MIN_MATCH_LENGTH <= input.size())
+		{
+			u16 maxLength = (u16)std::min<size_t>(MAX_MATCH_LENGTH, input.size() - position);
+			s32 candidate = hashHeads[getHash(position)];
+
+			for (u8 chainLength = 0; (candidate != NO_POSITION) && (position - candidate <= WINDOW_SIZE) && (chainLength < MAX_CHAIN_LENGTH); ++chainLength)
+			{
+				u16 length = 0;
+
+				while ((length < maxLength) && (input[candidate + length] == input[position + length]))
+					++length;
+
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = (u16)(position - candidate);
+
+					if (length == maxLength)
+						break;
+				}
+
+				candidate = previousPositions[candidate];
+			}
+		}
+
+		if (bestLength >= MIN_MATCH_LENGTH)
+		{
+			writeMatch(bitWriter, bestLength, bestDistance);
+
+			for (u16 n = 0; n < bestLength; ++n)
+				insertPosition(position + n);
+
+			position += bestLength;
+		}
+		else
+		{
+			writeSymbol(bitWriter, input[position]);
+			insertPosition(position);
+			++position;
+		}
+	}
+
+	writeSymbol(bitWriter, 256); // end of block
+	bitWriter.flush();
+}
+
+// frames of at most 256 colors are indexed with 1, 2, 4 or 8 bits per pixel, returns false for the others
+bool getColorIndices(const FrameSink::Frame& frame, std::vector<u32>& palette, std::vector<u8>& indices)
+{
+	std::unordered_map<u32, u8> paletteIndices;
+	indices.resize(frame.size());
+
+	for (size_t pixelNumber = 0; pixelNumber < frame.size(); ++pixelNumber)
+	{
+		auto paletteIndex = paletteIndices.find(frame[pixelNumber]);
+
+		if (paletteIndex == paletteIndices.end())
+		{
+			if (palette.size() == 256)
+				return false;
+
+			paletteIndex = paletteIndices.emplace(frame[pixelNumber], (u8)palette.size()).first;
+			palette.push_back(frame[pixelNumber]);
+		}
+
+		indices[pixelNumber] = paletteIndex->second;
+	}
+
+	return true;
+}
+
+bool writePng(const std::string& filename, const FrameSink::Frame& frame)
+{
+	std::vector<u32> palette;
+	std::vector<u8> indices;
+	bool indexed = getColorIndices(frame, palette, indices);
+	u8 bitDepth = !indexed ? 8 : (palette.size() <= 2) ? 1 : (palette.size() <= 4) ? 2 : (palette.size() <= 16) ? 4 : 8;
+
+	// each line starts with filter type 0 (none), the indices are packed from the most significant bits
+	std::vector<u8> pixels;
+
+	for (u8 y = 0; y < FrameSink::FRAME_HEIGHT; ++y)
+	{
+		pixels.push_back(0);
+
+		for (u8 x = 0; x < FrameSink::FRAME_WIDTH; ++x)
+		{
+			u32 pixel = frame[y * FrameSink::FRAME_WIDTH + x];
+
+			if (!indexed)
+			{
+				pixels.push_back((u8)(pixel >> 16));
+				pixels.push_back((u8)(pixel >> 8));
+				pixels.push_back((u8)pixel);
+				continue;
+			}
+
+			u16 bitOffset = x * bitDepth;
+
+			if (bitOffset % 8 == 0)
+				pixels.push_back(0);
+
+			pixels.back() |= indices[y * FrameSink::FRAME_WIDTH + x] << (8 - bitDepth - bitOffset % 8);
+		}
+	}
+
+	// zlib stream of a single deflate block
+	std::vector<u8> imageData = { 0x78, 0x01 };
+	deflate(pixels, imageData);
+
+	u32 adlerA = 1, adlerB = 0;
+
+	for (u8 byte : pixels)
+	{
+		adlerA = (adlerA + byte) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+
+	append_u32(imageData, (adlerB << 16) | adlerA);
+
+	std::vector<u8> header;
+	append_u32(header, FrameSink::FRAME_WIDTH);
+	append_u32(header, FrameSink::FRAME_HEIGHT);
+	header.insert(header.end(), { bitDepth, (u8)(indexed ? 3 : 2), 0, 0, 0 }); // bit depth, indexed or RGB color type, compression, filter, interlace
+
+	std::vector<u8> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	appendChunk(png, "IHDR", header);
+
+	if (indexed)
+	{
+		std::vector<u8> paletteData;
+
+		for (u32 color : palette)
+			paletteData.insert(paletteData.end(), { (u8)(color >> 16), (u8)(color >> 8), (u8)color });
+
+		appendChunk(png, "PLTE", paletteData);
+	}
+
+	appendChunk(png, "IDAT", imageData);
+	appendChunk(png, "IEND", {});
+
+	std::ofstream file(filename, std::ios::binary);
+	return (bool)file.write((const char*)png.data(), png.size());
+}
@@ -0,0 +1,123 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "Resampler.h"
+#include "Sse2.h"
+#include "SincKernel.h"
+
+constexpr u8 Resampler::PHASE_BITS;
+constexpr u8 Resampler::KERNEL_BITS;
+constexpr u8 Resampler::POSITION_BITS;
+
+// kernel width in output samples, the transition band of the Blackman window is then about a sixth of the output rate
+constexpr u8 KERNEL_WIDTH = 32;
+// of the output rate, 21.6 kHz at 48 kHz
+constexpr double CUTOFF = 0.45;
+// input samples kept beyond the kernel, the history is moved back to the start when they are used
+constexpr size_t HISTORY_MARGIN = 4096;
+
+Resampler::Resampler(u32 inputFrequency, u32 outputFrequency) : m_inputFrequency(inputFrequency)
+{
+	double ratio = (double)inputFrequency / outputFrequency;
+	m_tapCount = (u16)(((u32)std::ceil(KERNEL_WIDTH * ratio) + 7) / 8 * 8);
+
+	// cutoff in cycles per input sample
+	m_kernel = createSincKernel(CUTOFF / ratio, m_tapCount, 1 << PHASE_BITS, KERNEL_BITS);
+
+	m_left.resize(m_tapCount + HISTORY_MARGIN);
+	m_right.resize(m_tapCount + HISTORY_MARGIN);
+
+	setOutputFrequency(outputFrequency);
+}
+
+void Resampler::setOutputFrequency(u32 outputFrequency)
+{
+	m_step = ((u64)m_inputFrequency << POSITION_BITS) / outputFrequency;
+}
+
+void Resampler::resample(const StereoSample* input, u16 inputCount, std::vector<StereoSample>& output)
+{
+	if (m_inputCount + inputCount > m_left.size())
+	{
+		size_t usedCount = (size_t)(m_position >> POSITION_BITS);
+		std::copy(m_left.begin() + usedCount, m_left.begin() + m_inputCount, m_left.begin());
+		std::copy(m_right.begin() + usedCount, m_right.begin() + m_inputCount, m_right.begin());
+		m_inputCount -= usedCount;
+		m_silenceStart -= std::min(m_silenceStart, usedCount);
+		m_position -= (u64)usedCount << POSITION_BITS;
+	}
+
+	for (u16 n = 0; n < inputCount; ++n, ++m_inputCount)
+	{
+		m_left[m_inputCount] = input[n].left;
+		m_right[m_inputCount] = input[n].right;
+
+		if (input[n].left || input[n].right)
+			m_silenceStart = m_inputCount + 1;
+	}
+
+	for (; (size_t)(m_position >> POSITION_BITS) + m_tapCount <= m_inputCount; m_position += m_step)
+	{
+		size_t first = (size_t)(m_position >> POSITION_BITS);
+
+		if (first >= m_silenceStart)
+		{
+			output.push_back({ 0, 0 });
+			continue;
+		}
+
+		u16 phase = (u32)m_position >> (32 - PHASE_BITS);
+		const s16* kernel = &m_kernel[phase * m_tapCount];
+		const s16* left = &m_left[first];
+		const s16* right = &m_right[first];
+		s32 leftSum = 0;
+		s32 rightSum = 0;
+
+#ifdef HAS_SSE2
+		__m128i leftSums = _mm_setzero_si128();
+		__m128i rightSums = _mm_setzero_si128();
+
+		for (u16 n = 0; n < m_tapCount; n += 8)
+		{
+			__m128i taps = _mm_loadu_si128((const __m128i*)&kernel[n]);
+			leftSums = _mm_add_epi32(leftSums, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&left[n]), taps));
+			rightSums = _mm_add_epi32(rightSums, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&right[n]), taps));
+		}
+
+		// horizontal sums, the left one in the low lane and the right one in the next
+		__m128i sums = _mm_add_epi32(_mm_unpacklo_epi32(leftSums, rightSums), _mm_unpackhi_epi32(leftSums, rightSums));
+		sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 8));
+		leftSum = _mm_cvtsi128_si32(sums);
+		rightSum = _mm_cvtsi128_si32(_mm_srli_si128(sums, 4));
+#else
+		for (u16 n = 0; n < m_tapCount; ++n)
+		{
+			leftSum += left[n] * kernel[n];
+			rightSum += right[n] * kernel[n];
+		}
+#endif
+
+		s16 leftSample = (s16)std::min(std::max(leftSum >> KERNEL_BITS, -32768), 32767);
+		s16 rightSample = (s16)std::min(std::max(rightSum >> KERNEL_BITS, -32768), 32767);
+		output.push_back({ leftSample, rightSample });
+	}
+}
@@ -0,0 +1,60 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Types.h"
+#include "Mixer.h"
+
+// polyphase windowed-sinc decimator from the native rate of the APU to the output rate,
+// the output is delayed by half the kernel width
+class Resampler
+{
+public:
+	// the kernel is designed for the nominal output frequency, which must be lower than the input frequency
+	Resampler(u32 inputFrequency, u32 outputFrequency);
+
+	// small changes of the output frequency only move the step between output samples
+	void setOutputFrequency(u32 outputFrequency);
+	// appends the output samples that are complete, the input count must not exceed 4096
+	void resample(const StereoSample* input, u16 inputCount, std::vector<StereoSample>& output);
+
+private:
+	static constexpr u8 PHASE_BITS = 6;
+	// kernel taps of each phase sum to 1 << KERNEL_BITS
+	static constexpr u8 KERNEL_BITS = 15;
+	static constexpr u8 POSITION_BITS = 32;
+
+	u32 m_inputFrequency;
+	u16 m_tapCount;
+	// one row of m_tapCount taps per phase, the tap count is a multiple of 8
+	std::vector<s16> m_kernel;
+
+	// planar input history, the position of the next output sample is in 32.32 fixed-point from its start
+	std::vector<s16> m_left;
+	std::vector<s16> m_right;
+	size_t m_inputCount = 0;
+	// start of the trailing silence of the history, the output is 0 while the kernel stays in it
+	size_t m_silenceStart = 0;
+	u64 m_position = 0;
+	u64 m_step = 0;
+};
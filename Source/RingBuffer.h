@@ -0,0 +1,91 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "Types.h"
+
+// lock-free ring between exactly one producer thread and one consumer thread
+template<typename T>
+class RingBuffer
+{
+public:
+	// the capacity is rounded up to a power of two
+	explicit RingBuffer(size_t capacity)
+	{
+		size_t size = 1;
+
+		while (size < capacity)
+			size <<= 1;
+
+		m_data.resize(size);
+	}
+
+	// producer side, returns the number of elements written, the rest is dropped when the ring is full
+	size_t push(const T* data, size_t count)
+	{
+		size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+		size_t readIndex = m_readIndex.load(std::memory_order_acquire);
+		count = std::min(count, m_data.size() - (writeIndex - readIndex));
+
+		size_t offset = writeIndex & (m_data.size() - 1);
+		size_t firstCount = std::min(count, m_data.size() - offset);
+		std::copy_n(data, firstCount, &m_data[offset]);
+		std::copy_n(data + firstCount, count - firstCount, m_data.data());
+
+		m_writeIndex.store(writeIndex + count, std::memory_order_release);
+		return count;
+	}
+
+	// consumer side, returns the number of elements read
+	size_t pop(T* data, size_t count)
+	{
+		size_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+		size_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+		count = std::min(count, writeIndex - readIndex);
+
+		size_t offset = readIndex & (m_data.size() - 1);
+		size_t firstCount = std::min(count, m_data.size() - offset);
+		std::copy_n(&m_data[offset], firstCount, data);
+		std::copy_n(m_data.data(), count - firstCount, data + firstCount);
+
+		m_readIndex.store(readIndex + count, std::memory_order_release);
+		return count;
+	}
+
+	// exact from either side for its own operations, a snapshot otherwise
+	size_t getSize() const
+	{
+		return m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_acquire);
+	}
+
+	size_t getCapacity() const
+	{
+		return m_data.size();
+	}
+
+private:
+	std::vector<T> m_data;
+	std::atomic<size_t> m_writeIndex{0};
+	std::atomic<size_t> m_readIndex{0};
+};
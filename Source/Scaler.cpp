@@ -0,0 +1,426 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Scaler.h"
+#include "Sse2.h"
+
+constexpr u8 PADDING = 2;
+constexpr u16 PADDED_WIDTH = FrameSink::FRAME_WIDTH + 2 * PADDING;
+constexpr u16 PADDED_HEIGHT = FrameSink::FRAME_HEIGHT + 2 * PADDING;
+
+#ifdef HAS_SSE2
+inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// stores a0 b0 c0 a1 b1 c1 a2 b2 c2 a3 b3 c3
+inline void storeInterleaved3(u32* destination, __m128i a, __m128i b, __m128i c)
+{
+	__m128 ab0 = _mm_castsi128_ps(_mm_unpacklo_epi32(a, b));
+	__m128 ab1 = _mm_castsi128_ps(_mm_unpackhi_epi32(a, b));
+	__m128 bc0 = _mm_castsi128_ps(_mm_unpacklo_epi32(b, c));
+	__m128 bc1 = _mm_castsi128_ps(_mm_unpackhi_epi32(b, c));
+	__m128 ca0 = _mm_castsi128_ps(_mm_unpacklo_epi32(c, a));
+	__m128 ca1 = _mm_castsi128_ps(_mm_unpackhi_epi32(c, a));
+
+	_mm_storeu_si128((__m128i*)destination, _mm_castps_si128(_mm_shuffle_ps(ab0, ca0, _MM_SHUFFLE(3, 0, 1, 0))));
+	_mm_storeu_si128((__m128i*)(destination + 4), _mm_castps_si128(_mm_shuffle_ps(bc0, ab1, _MM_SHUFFLE(1, 0, 3, 2))));
+	_mm_storeu_si128((__m128i*)(destination + 8), _mm_castps_si128(_mm_shuffle_ps(ca1, bc1, _MM_SHUFFLE(3, 2, 3, 0))));
+}
+
+inline __m128i abs_epi32(__m128i value)
+{
+	__m128i sign = _mm_srai_epi32(value, 31);
+	return _mm_sub_epi32(_mm_xor_si128(value, sign), sign);
+}
+
+// same as Scaler::getColorDistance on 4 pairs of pixels
+inline __m128i getColorDistances(__m128i color0, __m128i color1)
+{
+	// red in the low 16 bits and green in the high ones, blue alone, for the multiply-adds of the differences
+	__m128i lowByte = _mm_set1_epi32(0xFF);
+	__m128i redGreen0 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(color0, 16), lowByte), _mm_and_si128(_mm_slli_epi32(color0, 8), _mm_set1_epi32(0xFF0000)));
+	__m128i redGreen1 = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(color1, 16), lowByte), _mm_and_si128(_mm_slli_epi32(color1, 8), _mm_set1_epi32(0xFF0000)));
+	__m128i redGreen = _mm_sub_epi16(redGreen0, redGreen1);
+	__m128i blue = _mm_sub_epi16(_mm_and_si128(color0, lowByte), _mm_and_si128(color1, lowByte));
+
+	auto setWeights = [](s16 redWeight, s16 greenWeight) { return _mm_set1_epi32((int)((u32)(u16)redWeight | ((u32)(u16)greenWeight << 16))); };
+	__m128i y = _mm_add_epi32(_mm_madd_epi16(redGreen, setWeights(299, 587)), _mm_madd_epi16(blue, setWeights(114, 0)));
+	__m128i u = _mm_add_epi32(_mm_madd_epi16(redGreen, setWeights(-169, -331)), _mm_madd_epi16(blue, setWeights(500, 0)));
+	__m128i v = _mm_add_epi32(_mm_madd_epi16(redGreen, setWeights(500, -419)), _mm_madd_epi16(blue, setWeights(-81, 0)));
+
+	y = abs_epi32(y);
+	u = abs_epi32(u);
+	v = abs_epi32(v);
+
+	// 48 y + 7 u + 6 v
+	__m128i distance = _mm_add_epi32(_mm_slli_epi32(y, 5), _mm_slli_epi32(y, 4));
+	distance = _mm_add_epi32(distance, _mm_sub_epi32(_mm_slli_epi32(u, 3), u));
+	return _mm_add_epi32(distance, _mm_add_epi32(_mm_slli_epi32(v, 2), _mm_slli_epi32(v, 1)));
+}
+
+// same as Scaler::getXbrCornerPixel on 4 pixels
+inline __m128i getXbrCornerPixels(__m128i E, __m128i I, __m128i H, __m128i F, __m128i G, __m128i C, __m128i D, __m128i B, __m128i F4, __m128i I4, __m128i H5, __m128i I5)
+{
+	__m128i alongEdge = _mm_add_epi32(_mm_add_epi32(getColorDistances(E, C), getColorDistances(E, G)), _mm_add_epi32(getColorDistances(I, F4), getColorDistances(I, H5)));
+	alongEdge = _mm_add_epi32(alongEdge, _mm_slli_epi32(getColorDistances(H, F), 2));
+	__m128i acrossEdge = _mm_add_epi32(_mm_add_epi32(getColorDistances(H, D), getColorDistances(H, I5)), _mm_add_epi32(getColorDistances(F, I4), getColorDistances(F, B)));
+	acrossEdge = _mm_add_epi32(acrossEdge, _mm_slli_epi32(getColorDistances(E, I), 2));
+
+	__m128i keepCenter = _mm_or_si128(_mm_cmpeq_epi32(E, F), _mm_cmpeq_epi32(E, H));
+	__m128i blend = _mm_andnot_si128(keepCenter, _mm_cmplt_epi32(alongEdge, acrossEdge));
+
+	__m128i edgePixel = select(_mm_cmpgt_epi32(getColorDistances(E, F), getColorDistances(E, H)), H, F);
+
+	__m128i evenBits = _mm_set1_epi32(0xFEFEFE);
+	__m128i average = _mm_add_epi32(_mm_srli_epi32(_mm_and_si128(E, evenBits), 1), _mm_srli_epi32(_mm_and_si128(edgePixel, evenBits), 1));
+	average = _mm_add_epi32(average, _mm_and_si128(_mm_and_si128(E, edgePixel), _mm_set1_epi32(0x010101)));
+
+	return select(blend, average, E);
+}
+#endif
+
+Scaler::Scaler(Settings::ScalingFilter filter, u8 scale) :
+	m_filter(filter),
+	m_scale(scale)
+{
+	if (m_filter != Settings::NEAREST_FILTER)
+		m_paddedFrame.resize(PADDED_WIDTH * PADDED_HEIGHT);
+}
+
+u16 Scaler::getOutputWidth()
+{
+	return FrameSink::FRAME_WIDTH * m_scale;
+}
+
+u16 Scaler::getOutputHeight()
+{
+	return FrameSink::FRAME_HEIGHT * m_scale;
+}
+
+void Scaler::scale(const FrameSink::Frame& frame, u32* output, u32 outputPitch)
+{
+	if (m_filter == Settings::NEAREST_FILTER)
+	{
+		scaleNearest(frame, output, outputPitch);
+		return;
+	}
+
+	copyToPaddedFrame(frame);
+
+	switch (m_filter)
+	{
+	case Settings::SCALE2X_FILTER:
+		scale2x(output, outputPitch);
+		break;
+
+	case Settings::SCALE3X_FILTER:
+		scale3x(output, outputPitch);
+		break;
+
+	case Settings::XBR_FILTER:
+		scaleXbr(output, outputPitch);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void Scaler::scaleNearest(const FrameSink::Frame& frame, u32* output, u32 outputPitch)
+{
+	for (u16 y = 0; y < FrameSink::FRAME_HEIGHT; ++y)
+	{
+		const u32* line = &frame[y * FrameSink::FRAME_WIDTH];
+		u32* outputLine = output + y * m_scale * outputPitch;
+		u16 x = 0;
+
+#ifdef HAS_SSE2
+		if ((2 <= m_scale) && (m_scale <= 4))
+		{
+			for (__m128i* destination = (__m128i*)outputLine; x < FrameSink::FRAME_WIDTH; x += 4)
+			{
+				__m128i pixels = _mm_loadu_si128((const __m128i*)&line[x]);
+
+				if (m_scale == 2)
+				{
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 1, 0, 0)));
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 2, 2)));
+				}
+				else if (m_scale == 3)
+				{
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+				}
+				else
+				{
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 0, 0, 0)));
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 1, 1, 1)));
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 2, 2)));
+					_mm_storeu_si128(destination++, _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3)));
+				}
+			}
+		}
+#endif
+
+		for (; x < FrameSink::FRAME_WIDTH; ++x)
+			std::fill_n(outputLine + x * m_scale, m_scale, line[x]);
+
+		// the other lines of the block are copies of the first one
+		for (u8 lineNumber = 1; lineNumber < m_scale; ++lineNumber)
+			std::copy_n(outputLine, getOutputWidth(), outputLine + lineNumber * outputPitch);
+	}
+}
+
+void Scaler::scale2x(u32* output, u32 outputPitch)
+{
+	for (u16 y = 0; y < FrameSink::FRAME_HEIGHT; ++y)
+	{
+		u32* outputLine0 = output + y * 2 * outputPitch;
+		u32* outputLine1 = outputLine0 + outputPitch;
+		u16 x = 0;
+
+#ifdef HAS_SSE2
+		for (; x < FrameSink::FRAME_WIDTH; x += 4)
+		{
+			const u32* center = &m_paddedFrame[(y + PADDING) * PADDED_WIDTH + x + PADDING];
+			__m128i B = _mm_loadu_si128((const __m128i*)(center - PADDED_WIDTH));
+			__m128i D = _mm_loadu_si128((const __m128i*)(center - 1));
+			__m128i E = _mm_loadu_si128((const __m128i*)center);
+			__m128i F = _mm_loadu_si128((const __m128i*)(center + 1));
+			__m128i H = _mm_loadu_si128((const __m128i*)(center + PADDED_WIDTH));
+
+			__m128i BD = _mm_cmpeq_epi32(B, D);
+			__m128i BF = _mm_cmpeq_epi32(B, F);
+			__m128i DH = _mm_cmpeq_epi32(D, H);
+			__m128i FH = _mm_cmpeq_epi32(F, H);
+
+			__m128i E0 = select(_mm_andnot_si128(_mm_or_si128(BF, DH), BD), D, E);
+			__m128i E1 = select(_mm_andnot_si128(_mm_or_si128(BD, FH), BF), F, E);
+			__m128i E2 = select(_mm_andnot_si128(_mm_or_si128(BD, FH), DH), D, E);
+			__m128i E3 = select(_mm_andnot_si128(_mm_or_si128(DH, BF), FH), F, E);
+
+			_mm_storeu_si128((__m128i*)&outputLine0[x * 2], _mm_unpacklo_epi32(E0, E1));
+			_mm_storeu_si128((__m128i*)&outputLine0[x * 2 + 4], _mm_unpackhi_epi32(E0, E1));
+			_mm_storeu_si128((__m128i*)&outputLine1[x * 2], _mm_unpacklo_epi32(E2, E3));
+			_mm_storeu_si128((__m128i*)&outputLine1[x * 2 + 4], _mm_unpackhi_epi32(E2, E3));
+		}
+#endif
+
+		for (; x < FrameSink::FRAME_WIDTH; ++x)
+		{
+			u32 B = getPaddedPixel(x, y - 1), D = getPaddedPixel(x - 1, y), E = getPaddedPixel(x, y);
+			u32 F = getPaddedPixel(x + 1, y), H = getPaddedPixel(x, y + 1);
+
+			outputLine0[x * 2] = (D == B && B != F && D != H) ? D : E;
+			outputLine0[x * 2 + 1] = (B == F && B != D && F != H) ? F : E;
+			outputLine1[x * 2] = (D == H && D != B && H != F) ? D : E;
+			outputLine1[x * 2 + 1] = (H == F && D != H && B != F) ? F : E;
+		}
+	}
+}
+
+void Scaler::scale3x(u32* output, u32 outputPitch)
+{
+	for (u16 y = 0; y < FrameSink::FRAME_HEIGHT; ++y)
+	{
+		u32* outputLine0 = output + y * 3 * outputPitch;
+		u32* outputLine1 = outputLine0 + outputPitch;
+		u32* outputLine2 = outputLine1 + outputPitch;
+		u16 x = 0;
+
+#ifdef HAS_SSE2
+		for (; x < FrameSink::FRAME_WIDTH; x += 4)
+		{
+			const u32* center = &m_paddedFrame[(y + PADDING) * PADDED_WIDTH + x + PADDING];
+			__m128i A = _mm_loadu_si128((const __m128i*)(center - PADDED_WIDTH - 1));
+			__m128i B = _mm_loadu_si128((const __m128i*)(center - PADDED_WIDTH));
+			__m128i C = _mm_loadu_si128((const __m128i*)(center - PADDED_WIDTH + 1));
+			__m128i D = _mm_loadu_si128((const __m128i*)(center - 1));
+			__m128i E = _mm_loadu_si128((const __m128i*)center);
+			__m128i F = _mm_loadu_si128((const __m128i*)(center + 1));
+			__m128i G = _mm_loadu_si128((const __m128i*)(center + PADDED_WIDTH - 1));
+			__m128i H = _mm_loadu_si128((const __m128i*)(center + PADDED_WIDTH));
+			__m128i I = _mm_loadu_si128((const __m128i*)(center + PADDED_WIDTH + 1));
+
+			__m128i equalBD = _mm_cmpeq_epi32(B, D);
+			__m128i equalBF = _mm_cmpeq_epi32(B, F);
+			__m128i equalDH = _mm_cmpeq_epi32(D, H);
+			__m128i equalFH = _mm_cmpeq_epi32(F, H);
+			__m128i equalEA = _mm_cmpeq_epi32(E, A);
+			__m128i equalEC = _mm_cmpeq_epi32(E, C);
+			__m128i equalEG = _mm_cmpeq_epi32(E, G);
+			__m128i equalEI = _mm_cmpeq_epi32(E, I);
+
+			__m128i BD = _mm_andnot_si128(_mm_or_si128(equalBF, equalDH), equalBD);
+			__m128i BF = _mm_andnot_si128(_mm_or_si128(equalBD, equalFH), equalBF);
+			__m128i DH = _mm_andnot_si128(_mm_or_si128(equalBD, equalFH), equalDH);
+			__m128i FH = _mm_andnot_si128(_mm_or_si128(equalDH, equalBF), equalFH);
+
+			__m128i E0 = select(BD, D, E);
+			__m128i E1 = select(_mm_or_si128(_mm_andnot_si128(equalEC, BD), _mm_andnot_si128(equalEA, BF)), B, E);
+			__m128i E2 = select(BF, F, E);
+			__m128i E3 = select(_mm_or_si128(_mm_andnot_si128(equalEG, BD), _mm_andnot_si128(equalEA, DH)), D, E);
+			__m128i E5 = select(_mm_or_si128(_mm_andnot_si128(equalEI, BF), _mm_andnot_si128(equalEC, FH)), F, E);
+			__m128i E6 = select(DH, D, E);
+			__m128i E7 = select(_mm_or_si128(_mm_andnot_si128(equalEI, DH), _mm_andnot_si128(equalEG, FH)), H, E);
+			__m128i E8 = select(FH, F, E);
+
+			storeInterleaved3(&outputLine0[x * 3], E0, E1, E2);
+			storeInterleaved3(&outputLine1[x * 3], E3, E, E5);
+			storeInterleaved3(&outputLine2[x * 3], E6, E7, E8);
+		}
+#endif
+
+		for (; x < FrameSink::FRAME_WIDTH; ++x)
+		{
+			u32 A = getPaddedPixel(x - 1, y - 1), B = getPaddedPixel(x, y - 1), C = getPaddedPixel(x + 1, y - 1);
+			u32 D = getPaddedPixel(x - 1, y), E = getPaddedPixel(x, y), F = getPaddedPixel(x + 1, y);
+			u32 G = getPaddedPixel(x - 1, y + 1), H = getPaddedPixel(x, y + 1), I = getPaddedPixel(x + 1, y + 1);
+
+			bool BD = (D == B) && (B != F) && (D != H);
+			bool BF = (B == F) && (B != D) && (F != H);
+			bool DH = (D == H) && (D != B) && (H != F);
+			bool FH = (H == F) && (D != H) && (B != F);
+
+			outputLine0[x * 3] = BD ? D : E;
+			outputLine0[x * 3 + 1] = ((BD && E != C) || (BF && E != A)) ? B : E;
+			outputLine0[x * 3 + 2] = BF ? F : E;
+			outputLine1[x * 3] = ((BD && E != G) || (DH && E != A)) ? D : E;
+			outputLine1[x * 3 + 1] = E;
+			outputLine1[x * 3 + 2] = ((BF && E != I) || (FH && E != C)) ? F : E;
+			outputLine2[x * 3] = DH ? D : E;
+			outputLine2[x * 3 + 1] = ((DH && E != I) || (FH && E != G)) ? H : E;
+			outputLine2[x * 3 + 2] = FH ? F : E;
+		}
+	}
+}
+
+void Scaler::scaleXbr(u32* output, u32 outputPitch)
+{
+	for (u16 y = 0; y < FrameSink::FRAME_HEIGHT; ++y)
+	{
+		u32* outputLine0 = output + y * 2 * outputPitch;
+		u32* outputLine1 = outputLine0 + outputPitch;
+		s16 x = 0;
+
+#ifdef HAS_SSE2
+		for (; x < FrameSink::FRAME_WIDTH; x += 4)
+		{
+			const u32* center = &m_paddedFrame[(y + PADDING) * PADDED_WIDTH + x + PADDING];
+			auto load = [center](s16 dx, s16 dy) { return _mm_loadu_si128((const __m128i*)(center + dy * PADDED_WIDTH + dx)); };
+
+			__m128i A1 = load(-1, -2), B1 = load(0, -2), C1 = load(1, -2);
+			__m128i A0 = load(-2, -1), A = load(-1, -1), B = load(0, -1), C = load(1, -1), C4 = load(2, -1);
+			__m128i D0 = load(-2, 0), D = load(-1, 0), E = load(0, 0), F = load(1, 0), F4 = load(2, 0);
+			__m128i G0 = load(-2, 1), G = load(-1, 1), H = load(0, 1), I = load(1, 1), I4 = load(2, 1);
+			__m128i G5 = load(-1, 2), H5 = load(0, 2), I5 = load(1, 2);
+
+			__m128i E0 = getXbrCornerPixels(E, A, B, D, C, G, F, H, D0, A0, B1, A1);
+			__m128i E1 = getXbrCornerPixels(E, C, B, F, A, I, D, H, F4, C4, B1, C1);
+			__m128i E2 = getXbrCornerPixels(E, G, H, D, I, A, F, B, D0, G0, H5, G5);
+			__m128i E3 = getXbrCornerPixels(E, I, H, F, G, C, D, B, F4, I4, H5, I5);
+
+			_mm_storeu_si128((__m128i*)&outputLine0[x * 2], _mm_unpacklo_epi32(E0, E1));
+			_mm_storeu_si128((__m128i*)&outputLine0[x * 2 + 4], _mm_unpackhi_epi32(E0, E1));
+			_mm_storeu_si128((__m128i*)&outputLine1[x * 2], _mm_unpacklo_epi32(E2, E3));
+			_mm_storeu_si128((__m128i*)&outputLine1[x * 2 + 4], _mm_unpackhi_epi32(E2, E3));
+		}
+#endif
+
+		for (; x < FrameSink::FRAME_WIDTH; ++x)
+		{
+			//     A1 B1 C1
+			//  A0 A  B  C  C4
+			//  D0 D  E  F  F4
+			//  G0 G  H  I  I4
+			//     G5 H5 I5
+			u32 A1 = getPaddedPixel(x - 1, y - 2), B1 = getPaddedPixel(x, y - 2), C1 = getPaddedPixel(x + 1, y - 2);
+			u32 A0 = getPaddedPixel(x - 2, y - 1), A = getPaddedPixel(x - 1, y - 1), B = getPaddedPixel(x, y - 1), C = getPaddedPixel(x + 1, y - 1), C4 = getPaddedPixel(x + 2, y - 1);
+			u32 D0 = getPaddedPixel(x - 2, y), D = getPaddedPixel(x - 1, y), E = getPaddedPixel(x, y), F = getPaddedPixel(x + 1, y), F4 = getPaddedPixel(x + 2, y);
+			u32 G0 = getPaddedPixel(x - 2, y + 1), G = getPaddedPixel(x - 1, y + 1), H = getPaddedPixel(x, y + 1), I = getPaddedPixel(x + 1, y + 1), I4 = getPaddedPixel(x + 2, y + 1);
+			u32 G5 = getPaddedPixel(x - 1, y + 2), H5 = getPaddedPixel(x, y + 2), I5 = getPaddedPixel(x + 1, y + 2);
+
+			// each corner is the bottom right one of a mirrored neighborhood
+			outputLine0[x * 2] = getXbrCornerPixel(E, A, B, D, C, G, F, H, D0, A0, B1, A1);
+			outputLine0[x * 2 + 1] = getXbrCornerPixel(E, C, B, F, A, I, D, H, F4, C4, B1, C1);
+			outputLine1[x * 2] = getXbrCornerPixel(E, G, H, D, I, A, F, B, D0, G0, H5, G5);
+			outputLine1[x * 2 + 1] = getXbrCornerPixel(E, I, H, F, G, C, D, B, F4, I4, H5, I5);
+		}
+	}
+}
+
+void Scaler::copyToPaddedFrame(const FrameSink::Frame& frame)
+{
+	for (s16 y = -PADDING; y < FrameSink::FRAME_HEIGHT + PADDING; ++y)
+	{
+		s16 frameY = std::min<s16>(std::max<s16>(y, 0), FrameSink::FRAME_HEIGHT - 1);
+		const u32* line = &frame[frameY * FrameSink::FRAME_WIDTH];
+		u32* paddedLine = &m_paddedFrame[(y + PADDING) * PADDED_WIDTH];
+
+		std::fill_n(paddedLine, PADDING, line[0]);
+		std::copy_n(line, FrameSink::FRAME_WIDTH, paddedLine + PADDING);
+		std::fill_n(paddedLine + PADDING + FrameSink::FRAME_WIDTH, PADDING, line[FrameSink::FRAME_WIDTH - 1]);
+	}
+}
+
+u32 Scaler::getPaddedPixel(s16 x, s16 y)
+{
+	return m_paddedFrame[(y + PADDING) * PADDED_WIDTH + x + PADDING];
+}
+
+u32 Scaler::getColorDistance(u32 color0, u32 color1)
+{
+	if (color0 == color1)
+		return 0;
+
+	s32 red = (s32)((color0 >> 16) & 0xFF) - (s32)((color1 >> 16) & 0xFF);
+	s32 green = (s32)((color0 >> 8) & 0xFF) - (s32)((color1 >> 8) & 0xFF);
+	s32 blue = (s32)(color0 & 0xFF) - (s32)(color1 & 0xFF);
+
+	// YUV distance, weighted towards the luma. It is only compared, so the scale of the coefficients is kept
+	s32 y = 299 * red + 587 * green + 114 * blue;
+	s32 u = -169 * red - 331 * green + 500 * blue;
+	s32 v = 500 * red - 419 * green - 81 * blue;
+
+	return (u32)(48 * std::abs(y) + 7 * std::abs(u) + 6 * std::abs(v));
+}
+
+u32 Scaler::getXbrCornerPixel(u32 E, u32 I, u32 H, u32 F, u32 G, u32 C, u32 D, u32 B, u32 F4, u32 I4, u32 H5, u32 I5)
+{
+	if ((E == F) || (E == H))
+		return E;
+
+	// an edge runs along H-F when the pixels are closer in that direction than across it
+	u32 alongEdge = getColorDistance(E, C) + getColorDistance(E, G) + getColorDistance(I, F4) + getColorDistance(I, H5) + 4 * getColorDistance(H, F);
+	u32 acrossEdge = getColorDistance(H, D) + getColorDistance(H, I5) + getColorDistance(F, I4) + getColorDistance(F, B) + 4 * getColorDistance(E, I);
+
+	if (alongEdge >= acrossEdge)
+		return E;
+
+	u32 edgePixel = (getColorDistance(E, F) <= getColorDistance(E, H)) ? F : H;
+
+	// averages each component without overflowing into the next one
+	return ((E & 0xFEFEFE) >> 1) + ((edgePixel & 0xFEFEFE) >> 1) + (E & edgePixel & 0x010101);
+}
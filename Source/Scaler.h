@@ -0,0 +1,56 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "Types.h"
+#include "FrameSink.h"
+#include "Settings.h"
+
+// enlarges the frames on the CPU, before they are handed to the window surface
+class Scaler
+{
+public:
+	Scaler(Settings::ScalingFilter filter, u8 scale);
+
+	u16 getOutputWidth();
+	u16 getOutputHeight();
+
+	// outputPitch is in pixels
+	void scale(const FrameSink::Frame& frame, u32* output, u32 outputPitch);
+
+private:
+	void scaleNearest(const FrameSink::Frame& frame, u32* output, u32 outputPitch);
+	void scale2x(u32* output, u32 outputPitch);
+	void scale3x(u32* output, u32 outputPitch);
+	void scaleXbr(u32* output, u32 outputPitch);
+
+	void copyToPaddedFrame(const FrameSink::Frame& frame);
+	u32 getPaddedPixel(s16 x, s16 y);
+	u32 getColorDistance(u32 color0, u32 color1);
+	u32 getXbrCornerPixel(u32 E, u32 I, u32 H, u32 F, u32 G, u32 C, u32 D, u32 B, u32 F4, u32 I4, u32 H5, u32 I5);
+
+	Settings::ScalingFilter m_filter;
+	u8 m_scale;
+
+	// the frame with its edge pixels repeated around it, so that every pixel has neighbors
+	std::vector<u32> m_paddedFrame;
+};
@@ -0,0 +1,85 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Scheduler.h"
+
+constexpr u64 Scheduler::NEVER;
+
+Scheduler::Scheduler()
+{
+	m_eventCycles.fill(NEVER);
+}
+
+void Scheduler::doCycle()
+{
+	++m_currentCycle;
+
+	if (m_currentCycle >= m_nextEventCycle)
+		processEvents();
+}
+
+u64 Scheduler::getCurrentCycle()
+{
+	return m_currentCycle;
+}
+
+void Scheduler::setCallback(Event event, std::function<void()> callback)
+{
+	m_callbacks[event] = std::move(callback);
+}
+
+void Scheduler::schedule(Event event, u64 cycle)
+{
+	m_eventCycles[event] = cycle;
+	updateNextEventCycle();
+}
+
+void Scheduler::unschedule(Event event)
+{
+	m_eventCycles[event] = NEVER;
+	updateNextEventCycle();
+}
+
+void Scheduler::processEvents()
+{
+	while (m_nextEventCycle <= m_currentCycle)
+	{
+		for (u8 event = 0; event < EVENT_COUNT; ++event)
+		{
+			if (m_eventCycles[event] <= m_currentCycle)
+			{
+				m_eventCycles[event] = NEVER;
+				m_callbacks[event]();
+			}
+		}
+
+		updateNextEventCycle();
+	}
+}
+
+void Scheduler::updateNextEventCycle()
+{
+	m_nextEventCycle = NEVER;
+
+	for (u64 eventCycle : m_eventCycles)
+	{
+		if (eventCycle < m_nextEventCycle)
+			m_nextEventCycle = eventCycle;
+	}
+}
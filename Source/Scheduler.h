@@ -0,0 +1,57 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <functional>
+
+#include "Types.h"
+
+class Scheduler
+{
+public:
+	enum Event : u8
+	{
+		FRAME_EVENT,
+		DISPLAY_EVENT,
+		AUDIO_EVENT,
+		EVENT_COUNT
+	};
+
+	Scheduler();
+
+	void doCycle();
+	u64 getCurrentCycle();
+
+	void setCallback(Event event, std::function<void()> callback);
+	void schedule(Event event, u64 cycle);
+	void unschedule(Event event);
+
+private:
+	void processEvents();
+	void updateNextEventCycle();
+
+	static constexpr u64 NEVER = ~(u64)0;
+
+	u64 m_currentCycle = 0;
+	u64 m_nextEventCycle = NEVER;
+	std::array<u64, EVENT_COUNT> m_eventCycles;
+	std::array<std::function<void()>, EVENT_COUNT> m_callbacks;
+};
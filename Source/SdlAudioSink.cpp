@@ -0,0 +1,106 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+
+#include "Error.h"
+#include "SdlAudioSink.h"
+
+constexpr size_t RING_CAPACITY = 8192;
+// samples queued before the device starts reading, also the fill level kept with audio sync
+constexpr size_t START_LATENCY = 1024;
+// the sampling rate moves by at most 0.5% to bring the fill level back to the target
+constexpr double MAX_RATE_ADJUSTMENT = 0.005;
+constexpr double FILL_SMOOTHING = 1.0 / 16;
+
+void audioCallback(void* userData, u8* stream, int streamLength)
+{
+	SdlAudioSink& audioSink = *(SdlAudioSink*)userData;
+	audioSink.readSamples(stream, streamLength);
+}
+
+SdlAudioSink::SdlAudioSink(u32 samplingFrequency, bool audioSync) :
+	m_samplingFrequency(samplingFrequency),
+	m_audioSync(audioSync),
+	m_samples(RING_CAPACITY)
+{
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO))
+		throwError("Failed to init audio: ", SDL_GetError());
+
+	SDL_AudioSpec desiredParameters{};
+	desiredParameters.freq = samplingFrequency;
+	desiredParameters.format = AUDIO_S16SYS;
+	desiredParameters.channels = 2;
+	desiredParameters.samples = 512;
+	desiredParameters.callback = audioCallback;
+	desiredParameters.userdata = this;
+
+	if (SDL_OpenAudio(&desiredParameters, nullptr))
+		throwError("Failed to open the audio device: ", SDL_GetError());
+}
+
+SdlAudioSink::~SdlAudioSink()
+{
+	SDL_CloseAudio();
+	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+void SdlAudioSink::writeSamples(const StereoSample* samples, u16 sampleCount)
+{
+	// dropped when the emulation runs ahead of the device
+	m_samples.push(samples, sampleCount);
+
+	size_t fill = m_samples.getSize();
+
+	if (!m_playing && (fill >= START_LATENCY))
+	{
+		SDL_PauseAudio(0);
+		m_playing = true;
+	}
+
+	if (m_audioSync && m_playing)
+	{
+		m_averageFill += (fill - m_averageFill) * FILL_SMOOTHING;
+
+		// waits until the device has played the excess
+		if (fill > START_LATENCY)
+			std::this_thread::sleep_for(std::chrono::microseconds((fill - START_LATENCY) * 1'000'000 / m_samplingFrequency));
+	}
+}
+
+u32 SdlAudioSink::getSamplingFrequency() const
+{
+	if (!m_audioSync || !m_playing)
+		return m_samplingFrequency;
+
+	// more samples per emulated second when the ring runs low
+	double fillError = std::max(-1.0, std::min(1.0, (START_LATENCY - m_averageFill) / START_LATENCY));
+	return (u32)std::lround(m_samplingFrequency * (1 + MAX_RATE_ADJUSTMENT * fillError));
+}
+
+void SdlAudioSink::readSamples(u8* stream, int streamLength)
+{
+	size_t sampleCount = m_samples.pop((StereoSample*)stream, streamLength / sizeof(StereoSample));
+	std::fill(stream + sampleCount * sizeof(StereoSample), stream + streamLength, (u8)0);
+}
@@ -0,0 +1,47 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AudioSink.h"
+#include "RingBuffer.h"
+
+// plays the samples on the SDL audio device, the callback only copies them out of a lock-free ring.
+// With audio sync the fill level of the ring paces the emulation and slightly adjusts the sampling rate
+class SdlAudioSink : public AudioSink
+{
+public:
+	SdlAudioSink(u32 samplingFrequency, bool audioSync);
+	~SdlAudioSink();
+
+	void writeSamples(const StereoSample* samples, u16 sampleCount) override;
+	u32 getSamplingFrequency() const override;
+
+	// called from the audio thread
+	void readSamples(u8* stream, int streamLength);
+
+private:
+	u32 m_samplingFrequency;
+	bool m_audioSync;
+
+	RingBuffer<StereoSample> m_samples;
+	bool m_playing = false;
+	// smoothed over the writes, the callback empties the ring in bursts
+	double m_averageFill = 0;
+};
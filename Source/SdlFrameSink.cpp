@@ -0,0 +1,76 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <SDL.h>
+
+#include "Error.h"
+#include "SdlFrameSink.h"
+
+SdlFrameSink::SdlFrameSink(Settings::ScalingFilter scalingFilter, u8 scale) :
+	m_scaler(scalingFilter, scale),
+	m_scaledFrame(m_scaler.getOutputWidth() * m_scaler.getOutputHeight())
+{
+	if (SDL_InitSubSystem(SDL_INIT_VIDEO))
+		throwError("Failed to init video: ", SDL_GetError());
+
+	m_window = SDL_CreateWindow("CppGB", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, m_scaler.getOutputWidth(), m_scaler.getOutputHeight(), SDL_WINDOW_SHOWN);
+	
+	if (!m_window)
+		throwError("Failed to create window: ", SDL_GetError());
+
+	m_scaledSurface = SDL_CreateRGBSurfaceWithFormatFrom(m_scaledFrame.data(), m_scaler.getOutputWidth(), m_scaler.getOutputHeight(), 32, m_scaler.getOutputWidth() * sizeof(u32), SDL_PIXELFORMAT_RGB888);
+
+	if (!m_scaledSurface)
+		throwError("Failed to create surface: ", SDL_GetError());
+}
+
+SdlFrameSink::~SdlFrameSink()
+{
+	SDL_FreeSurface(m_scaledSurface);
+	SDL_DestroyWindow(m_window);
+	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
+
+void SdlFrameSink::drawFrame(const Frame& frame)
+{
+	m_scaler.scale(frame, m_scaledFrame.data(), m_scaler.getOutputWidth());
+
+	// the blit converts to the format of the window if needed
+	SDL_BlitSurface(m_scaledSurface, nullptr, SDL_GetWindowSurface(m_window), nullptr);
+	SDL_UpdateWindowSurface(m_window);
+}
+
+void SdlFrameSink::scaleFrame(const Frame& frame, u32* scaledFrame)
+{
+	m_scaler.scale(frame, scaledFrame, m_scaler.getOutputWidth());
+}
+
+void SdlFrameSink::presentScaledFrame(const u32* scaledFrame)
+{
+	// the surface is pointed at the frame for the blit, its pixels are never written through it
+	m_scaledSurface->pixels = const_cast<u32*>(scaledFrame);
+	SDL_BlitSurface(m_scaledSurface, nullptr, SDL_GetWindowSurface(m_window), nullptr);
+	SDL_UpdateWindowSurface(m_window);
+	m_scaledSurface->pixels = m_scaledFrame.data();
+}
+
+u32 SdlFrameSink::getScaledFrameSize()
+{
+	return (u32)m_scaledFrame.size();
+}
@@ -0,0 +1,48 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "FrameSink.h"
+#include "Scaler.h"
+
+struct SDL_Window;
+struct SDL_Surface;
+
+class SdlFrameSink : public FrameSink
+{
+public:
+	SdlFrameSink(Settings::ScalingFilter scalingFilter, u8 scale);
+	~SdlFrameSink();
+
+	void drawFrame(const Frame& frame) override;
+
+	// the two halves of drawFrame, only the second one must run on the thread that created the window
+	void scaleFrame(const Frame& frame, u32* scaledFrame);
+	void presentScaledFrame(const u32* scaledFrame);
+	u32 getScaledFrameSize();
+
+private:
+	SDL_Window* m_window;
+	Scaler m_scaler;
+	std::vector<u32> m_scaledFrame;
+	SDL_Surface* m_scaledSurface;
+};
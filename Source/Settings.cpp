@@ -0,0 +1,213 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+
+#include "Error.h"
+#include "Settings.h"
+
+u32 parseNumber(const std::string& option, const std::string& value, u32 maxValue)
+{
+	char* end = nullptr;
+	unsigned long number = std::strtoul(value.c_str(), &end, 10);
+
+	if (value.empty() || *end != '\0' || number > maxValue)
+		throwError("Invalid value for ", option, ": ", value);
+
+	return (u32)number;
+}
+
+Settings parseSettings(int argumentCount, char* arguments[])
+{
+	Settings settings;
+
+	for (int argumentNumber = 1; argumentNumber < argumentCount; ++argumentNumber)
+	{
+		std::string argument = arguments[argumentNumber];
+
+		auto getValue = [&]() -> std::string
+		{
+			if (argumentNumber + 1 == argumentCount)
+				throwError("Missing value for ", argument);
+
+			++argumentNumber;
+			return arguments[argumentNumber];
+		};
+
+		if (argument == "--video")
+		{
+			std::string value = getValue();
+
+			if (value == "sdl")
+				settings.videoBackend = Settings::SDL_VIDEO;
+			else if (value == "null")
+				settings.videoBackend = Settings::NULL_VIDEO;
+			else if (value == "buffer")
+				settings.videoBackend = Settings::BUFFER_VIDEO;
+			else
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--scale")
+		{
+			std::string value = getValue();
+			settings.scale = (u8)parseNumber(argument, value, 8);
+
+			if (settings.scale == 0)
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--filter")
+		{
+			std::string value = getValue();
+
+			if (value == "nearest")
+				settings.scalingFilter = Settings::NEAREST_FILTER;
+			else if (value == "scale2x")
+				settings.scalingFilter = Settings::SCALE2X_FILTER;
+			else if (value == "scale3x")
+				settings.scalingFilter = Settings::SCALE3X_FILTER;
+			else if (value == "xbr")
+				settings.scalingFilter = Settings::XBR_FILTER;
+			else
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--present-thread")
+			settings.presentationThread = true;
+		else if (argument == "--audio")
+		{
+			std::string value = getValue();
+
+			if (value == "sdl")
+				settings.audioBackend = Settings::SDL_AUDIO;
+			else if (value == "null")
+				settings.audioBackend = Settings::NULL_AUDIO;
+			else if (value == "wav")
+				settings.audioBackend = Settings::WAV_AUDIO;
+			else
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--wav-file")
+			settings.wavFilename = getValue();
+		else if (argument == "--audio-sync")
+			settings.audioSync = true;
+		else if (argument == "--sample-rate")
+		{
+			std::string value = getValue();
+			settings.samplingFrequency = parseNumber(argument, value, 96000);
+
+			if ((settings.samplingFrequency != 44100) && (settings.samplingFrequency != 48000) && (settings.samplingFrequency != 96000))
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--native-apu")
+			settings.nativeApu = true;
+		else if (argument == "--dump")
+			settings.dumpFilename = getValue();
+		else if (argument == "--dump-format")
+		{
+			std::string value = getValue();
+
+			if (value == "y4m")
+				settings.dumpFormat = Settings::Y4M_DUMP;
+			else if (value == "rgb")
+				settings.dumpFormat = Settings::RGB_DUMP;
+			else
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--capture-every")
+			settings.captureInterval = parseNumber(argument, getValue(), 0xFFFFFFFF);
+		else if (argument == "--capture-prefix")
+			settings.capturePrefix = getValue();
+		else if (argument == "--checksum-log")
+			settings.checksumFilename = getValue();
+		else if (argument == "--checksum-lines")
+			settings.lineChecksums = true;
+		else if (argument == "--compare")
+		{
+			settings.comparedChecksumLogs[0] = getValue();
+			settings.comparedChecksumLogs[1] = getValue();
+		}
+		else if (argument == "--observe")
+			settings.observationFilename = getValue();
+		else if (argument == "--observe-format")
+		{
+			std::string value = getValue();
+
+			if (value == "luminance")
+				settings.observationFormat = Settings::LUMINANCE_OBSERVATION;
+			else if (value == "indices")
+				settings.observationFormat = Settings::INDEX_OBSERVATION;
+			else
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--observe-size")
+		{
+			std::string value = getValue();
+			size_t separator = value.find('x');
+
+			if (separator == std::string::npos)
+				throwError("Invalid value for ", argument, ": ", value);
+
+			settings.observationWidth = (u8)parseNumber(argument, value.substr(0, separator), 160);
+			settings.observationHeight = (u8)parseNumber(argument, value.substr(separator + 1), 144);
+
+			if ((settings.observationWidth == 0) || (settings.observationHeight == 0))
+				throwError("Invalid value for ", argument, ": ", value);
+		}
+		else if (argument == "--frames")
+			settings.frameLimit = parseNumber(argument, getValue(), 0xFFFFFFFF);
+		else if (argument == "--bg-cache")
+			settings.backgroundCache = true;
+		else if (argument == "--skip-identical-frames")
+			settings.skipIdenticalFrames = true;
+		else if (argument == "--lazy-display")
+			settings.lazyDisplay = true;
+		else if (argument == "--render-threads")
+			settings.renderThreadCount = (u8)parseNumber(argument, getValue(), 16);
+		else if (argument == "--frameskip")
+		{
+			std::string value = getValue();
+
+			if (value == "auto")
+				settings.adaptiveFrameSkip = true;
+			else
+				settings.frameSkip = (u8)parseNumber(argument, value, 9);
+		}
+		else if (argument == "--uncapped")
+			settings.uncappedSpeed = true;
+		else if (argument.compare(0, 2, "--") == 0)
+			throwError("Unknown option ", argument);
+		else
+			settings.romFilename = argument;
+	}
+
+	if (settings.romFilename.empty() && settings.comparedChecksumLogs[0].empty())
+		throwError("Usage: CppGB.exe [options] <rom>\n       CppGB.exe --compare <log> <log>");
+
+	// the observations are read between frames by the main thread, which then also polls the events
+	if (!settings.observationFilename.empty())
+		settings.presentationThread = false;
+
+	u8 filterScale = (settings.scalingFilter == Settings::SCALE3X_FILTER) ? 3 : 2;
+
+	if (settings.scale == 0)
+		settings.scale = filterScale;
+	else if ((settings.scalingFilter != Settings::NEAREST_FILTER) && (settings.scale != filterScale))
+		throwError("The selected filter only supports a scale of ", (int)filterScale);
+
+	return settings;
+}
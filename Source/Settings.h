@@ -0,0 +1,84 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+#include "Types.h"
+
+struct Settings
+{
+	enum VideoBackend
+	{
+		SDL_VIDEO, NULL_VIDEO, BUFFER_VIDEO
+	};
+
+	enum AudioBackend
+	{
+		SDL_AUDIO, NULL_AUDIO, WAV_AUDIO
+	};
+
+	enum DumpFormat
+	{
+		Y4M_DUMP, RGB_DUMP
+	};
+
+	enum ObservationFormat
+	{
+		LUMINANCE_OBSERVATION, INDEX_OBSERVATION
+	};
+
+	enum ScalingFilter
+	{
+		NEAREST_FILTER, SCALE2X_FILTER, SCALE3X_FILTER, XBR_FILTER
+	};
+
+	std::string romFilename;
+	VideoBackend videoBackend = SDL_VIDEO;
+	bool presentationThread = false;
+	AudioBackend audioBackend = SDL_AUDIO;
+	std::string wavFilename = "audio.wav";
+	bool audioSync = false;
+	u32 samplingFrequency = 48000;
+	bool nativeApu = false;
+	ScalingFilter scalingFilter = NEAREST_FILTER;
+	u8 scale = 0; // 0 => default scale of the filter
+	u32 frameLimit = 0;
+	std::string dumpFilename;
+	DumpFormat dumpFormat = Y4M_DUMP;
+	u32 captureInterval = 0;
+	std::string capturePrefix = "capture_";
+	std::string checksumFilename;
+	bool lineChecksums = false;
+	std::string observationFilename;
+	ObservationFormat observationFormat = LUMINANCE_OBSERVATION;
+	u8 observationWidth = 160;
+	u8 observationHeight = 144;
+	std::string comparedChecksumLogs[2];
+	bool backgroundCache = false;
+	bool skipIdenticalFrames = false;
+	bool lazyDisplay = false;
+	u8 renderThreadCount = 0;
+	u8 frameSkip = 0;
+	bool adaptiveFrameSkip = false;
+	bool uncappedSpeed = false;
+};
+
+Settings parseSettings(int argumentCount, char* arguments[]);
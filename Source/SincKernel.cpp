@@ -0,0 +1,61 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+#include "SincKernel.h"
+
+std::vector<s16> createSincKernel(double cutoff, u16 tapCount, u16 phaseCount, u8 kernelBits)
+{
+	constexpr double PI = 3.14159265358979323846;
+
+	double halfWidth = tapCount / 2.0;
+	std::vector<s16> kernel(phaseCount * tapCount);
+	std::vector<double> taps(tapCount);
+
+	for (u16 phase = 0; phase < phaseCount; ++phase)
+	{
+		double sum = 0;
+
+		for (u16 n = 0; n < tapCount; ++n)
+		{
+			// the phase is the fraction of a sample the output sample is after the first tap
+			double x = n - halfWidth - (double)phase / phaseCount;
+			double sinc = (x == 0) ? 1 : std::sin(2 * PI * cutoff * x) / (2 * PI * cutoff * x);
+			double window = (std::abs(x) < halfWidth) ? 0.42 + 0.5 * std::cos(PI * x / halfWidth) + 0.08 * std::cos(2 * PI * x / halfWidth) : 0;
+
+			taps[n] = sinc * window;
+			sum += taps[n];
+		}
+
+		s16* phaseTaps = &kernel[phase * tapCount];
+		s32 roundedSum = 0;
+
+		for (u16 n = 0; n < tapCount; ++n)
+		{
+			phaseTaps[n] = (s16)std::lround(taps[n] / sum * (1 << kernelBits));
+			roundedSum += phaseTaps[n];
+		}
+
+		// the rounding error goes to the central tap
+		phaseTaps[tapCount / 2] += (s16)((1 << kernelBits) - roundedSum);
+	}
+
+	return kernel;
+}
@@ -0,0 +1,28 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "Types.h"
+
+// Blackman-windowed sinc with a cutoff in cycles per sample, one row of tapCount taps for each phase,
+// the taps of each phase sum to 1 << kernelBits so that a step integrates to its exact height
+std::vector<s16> createSincKernel(double cutoff, u16 tapCount, u16 phaseCount, u8 kernelBits);
@@ -17,14 +17,38 @@ You should have received a copy of the GNU General Public License
 along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <SDL.h>
+#include <algorithm>
 
-#include "Error.h"
 #include "Memory.h"
+#include "Scheduler.h"
+#include "Settings.h"
 #include "SoundController.h"
+#include "SdlAudioSink.h"
+#include "WavAudioSink.h"
 
-constexpr int SAMPLING_FREQUENCY = 48000;
-constexpr f32 SAMPLING_PERIOD = 1.0f / SAMPLING_FREQUENCY;
+constexpr u32 CYCLES_PER_SECOND = 1'048'576;
+
+// 512 Hz, length runs at 256 Hz, sweep at 128 Hz and envelope at 64 Hz
+constexpr u32 FRAME_SEQUENCER_CYCLES = CYCLES_PER_SECOND / 512;
+
+// the BlipBuffer time of one cycle is then the sampling frequency itself, at the native rate a sample is a cycle
+static_assert(CYCLES_PER_SECOND == (1 << BlipBuffer::FRACTION_BITS), "inexact sample time");
+
+// fractional bits of the channel 3 wave position
+constexpr u8 WAVE_POSITION_SHIFT = 16;
+
+// channel samples are centered on 0 and carry 8 fractional bits for the band-limited steps
+constexpr u8 AMPLITUDE_SHIFT = 8;
+
+// about 4 ms of emulated time between two updates when no sound register is accessed
+constexpr u32 AUDIO_UPDATE_CYCLES = 4096;
+constexpr u16 SAMPLE_CHUNK_SIZE = 256;
+
+// channel 3 steps through its 32 samples at 2 MHz / (2048 - x)
+u32 getWaveStepsPerSample(u16 x, u32 samplingFrequency)
+{
+	return (u32)(((u64)2'097'152 << WAVE_POSITION_SHIFT) / ((2048 - x) * (u64)samplingFrequency));
+}
 
 std::array<u8, 8> getRectangleWaveform(u8 dutyCycle)
 {
@@ -38,103 +62,179 @@ std::array<u8, 8> getRectangleWaveform(u8 dutyCycle)
 	return {};
 }
 
-std::vector<u8> getEnvelope(u8 envelopeRegister)
+SoundController::SoundController(Memory& memory, Scheduler& scheduler, const Settings& settings) :
+	m_memory(memory),
+	m_scheduler(scheduler),
+	m_samplingFrequency(settings.nativeApu ? CYCLES_PER_SECOND : settings.samplingFrequency)
 {
-	u8 defaultEnvelopeValue = envelopeRegister >> 4;
-	std::vector<u8> envelope(defaultEnvelopeValue + 1, defaultEnvelopeValue);
-
-	if (envelopeRegister & 0x07)
+	switch (settings.audioBackend)
 	{
-		if (envelopeRegister & 0x08)
-		{
-			u8 envelopeValue = 0;
+	case Settings::SDL_AUDIO:
+		m_audioSink = std::make_unique<SdlAudioSink>(settings.samplingFrequency, settings.audioSync && !settings.uncappedSpeed);
+		break;
 
-			for (u8& envelopeStep : envelope)
-			{
-				envelopeStep = envelopeValue;
-				++envelopeValue;
-			}
-		}
-		else
-		{
-			u8 envelopeValue = defaultEnvelopeValue;
+	case Settings::NULL_AUDIO:
+		return;
 
-			for (u8& envelopeStep : envelope)
-			{
-				envelopeStep = envelopeValue;
-				--envelopeValue;
-			}
-		}
+	case Settings::WAV_AUDIO:
+		m_audioSink = std::make_unique<WavAudioSink>(settings.wavFilename, settings.samplingFrequency);
+		break;
 	}
 
-	return envelope;
+	if (settings.nativeApu)
+		m_resampler = std::make_unique<Resampler>(CYCLES_PER_SECOND, settings.samplingFrequency);
+
+	for (u16 address = Memory::WAVEFORMRAM_ADDRESS; address < Memory::WAVEFORMRAM_ADDRESS + Memory::WAVEFORMRAM_SIZE; ++address)
+		writeToWaveformRam(address, m_memory.read(address));
+
+	m_scheduler.setCallback(Scheduler::AUDIO_EVENT, [this]
+	{
+		synchronize();
+		updateSamplingFrequency();
+		m_scheduler.schedule(Scheduler::AUDIO_EVENT, m_scheduler.getCurrentCycle() + AUDIO_UPDATE_CYCLES);
+	});
+
+	m_scheduler.schedule(Scheduler::AUDIO_EVENT, AUDIO_UPDATE_CYCLES);
+}
+
+void SoundController::synchronize(u16 address)
+{
+	if ((Memory::NR10_ADDRESS <= address) && (address < Memory::WAVEFORMRAM_ADDRESS + Memory::WAVEFORMRAM_SIZE))
+		synchronize();
 }
 
-void audioCallback(void* userData, u8* stream, int streamLength)
+// without a sink no sample is generated, the frame sequencer still runs so that NR52 reports the stopped channels
+void SoundController::synchronize()
 {
-	SoundController& soundController = *(SoundController*)userData;
-	soundController.generateSamples(stream, streamLength);
+	u64 cycle = m_scheduler.getCurrentCycle();
+
+	for (; m_frameSequencerCycle <= cycle; m_frameSequencerCycle += FRAME_SEQUENCER_CYCLES)
+	{
+		if (m_audioSink)
+			run(m_frameSequencerCycle);
+
+		clockFrameSequencer(m_frameSequencerCycle);
+	}
+
+	if (m_audioSink)
+		run(cycle);
 }
 
-SoundController::SoundController(Memory& memory) : m_memory(memory)
+void SoundController::run(u64 cycle)
 {
-	if (SDL_InitSubSystem(SDL_INIT_AUDIO))
-		throwError("Failed to init audio: ", SDL_GetError());
-		
-	SDL_AudioSpec desiredParameters{};
-	desiredParameters.freq = SAMPLING_FREQUENCY;
-	desiredParameters.format = AUDIO_U8;
-	desiredParameters.channels = 1;
-	desiredParameters.samples = 512;
-	desiredParameters.callback = audioCallback;
-	desiredParameters.userdata = this;
+	runChannels(cycle);
+
+	u64 sampleCount = getSampleTime(cycle) >> BlipBuffer::FRACTION_BITS;
+	std::array<StereoSample, SAMPLE_CHUNK_SIZE> samples;
+
+	while (m_sampleCount < sampleCount)
+	{
+		u16 chunkLength = (u16)std::min<u64>(sampleCount - m_sampleCount, SAMPLE_CHUNK_SIZE);
+		generateSamples(samples.data(), chunkLength);
+		m_sampleCount += chunkLength;
 
-	if (SDL_OpenAudio(&desiredParameters, nullptr))
-		throwError("Failed to open the audio device: ", SDL_GetError());
+		if (m_resampler)
+			m_resampler->resample(samples.data(), chunkLength, m_resampledSamples);
+		else
+			m_audioSink->writeSamples(samples.data(), chunkLength);
+	}
 
-	SDL_PauseAudio(0);
+	if (!m_resampledSamples.empty())
+	{
+		m_audioSink->writeSamples(m_resampledSamples.data(), (u16)m_resampledSamples.size());
+		m_resampledSamples.clear();
+	}
 }
 
-SoundController::~SoundController()
+u64 SoundController::getSampleTime(u64 cycle) const
 {
-	SDL_CloseAudio();
-	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	return m_baseTime + (cycle - m_baseCycle) * m_samplingFrequency;
 }
 
-void SoundController::generateSamples(u8* stream, int streamLength)
+// the mapping from cycles to sample times is rebased on the current cycle, the samples already placed don't move
+void SoundController::updateSamplingFrequency()
 {
-	std::fill_n(stream, streamLength, (u8)0);
+	u32 samplingFrequency = m_audioSink->getSamplingFrequency();
+
+	// the channels stay at the native rate, only the output step of the resampler changes
+	if (m_resampler)
+	{
+		m_resampler->setOutputFrequency(samplingFrequency);
+		return;
+	}
 
-	if ((m_memory.NR52 & 0x80) == 0)
+	if (samplingFrequency == m_samplingFrequency)
 		return;
 
-	m_levelDivisor_so1 = 8 - (m_memory.NR50 & 0x07);
-	m_levelDivisor_so2 = 8 - ((m_memory.NR50 >> 4) & 0x07);
+	u64 cycle = m_scheduler.getCurrentCycle();
+	m_baseTime = getSampleTime(cycle);
+	m_baseCycle = cycle;
+	m_samplingFrequency = samplingFrequency;
+	m_channel3.waveStepsPerSample = getWaveStepsPerSample(((m_memory.NR34 & 0x07) << 8) | m_memory.NR33, m_samplingFrequency);
+}
+
+// silent channels aren't generated and are mixed from a shared buffer of zeros, nothing is mixed when all of them are
+void SoundController::generateSamples(StereoSample* stream, u16 streamLength)
+{
+	static const std::array<s16, SAMPLE_CHUNK_SIZE> SILENCE{};
+
+	std::array<std::array<s16, SAMPLE_CHUNK_SIZE>, 4> channelSamples;
+	std::array<const s16*, 4> channels;
+	bool active = false;
+
+	auto readChannel = [&](BlipBuffer& blipBuffer, u8 channelNumber)
+	{
+		if (blipBuffer.isSilent())
+		{
+			blipBuffer.skipSamples(streamLength);
+			channels[channelNumber] = SILENCE.data();
+		}
+		else
+		{
+			blipBuffer.readSamples(channelSamples[channelNumber].data(), streamLength);
+			channels[channelNumber] = channelSamples[channelNumber].data();
+			active = true;
+		}
+	};
+
+	readChannel(m_channel1.blipBuffer, 0);
+	readChannel(m_channel2.blipBuffer, 1);
+	readChannel(m_channel4.blipBuffer, 3);
+
+	if (isChannel3Silent())
+	{
+		// a muted channel keeps playing its waveform
+		if (isChannel3On())
+			m_channel3.wavePosition += m_channel3.waveStepsPerSample * streamLength;
 
-	if (((m_memory.NR12 >> 4) || (m_memory.NR12 & 0x08)) && (m_memory.NR52 & 0x01))
-		generateSamples_channel1(stream, streamLength);
+		channels[2] = SILENCE.data();
+	}
+	else
+	{
+		generateSamples_channel3(channelSamples[2].data(), streamLength);
+		channels[2] = channelSamples[2].data();
+		active = true;
+	}
 
-	if (((m_memory.NR22 >> 4) || (m_memory.NR22 & 0x08)) && (m_memory.NR52 & 0x02))
-		generateSamples_channel2(stream, streamLength);
+	if (!active)
+	{
+		std::fill_n(stream, streamLength, StereoSample{ 0, 0 });
+		return;
+	}
 
-	if ((m_memory.NR30 & 0x80) && (m_memory.NR52 & 0x04))
-		generateSamples_channel3(stream, streamLength);
+	m_mixer.setVolumes(m_memory.NR50, m_memory.NR51);
+	m_mixer.mix(channels, stream, streamLength);
+}
 
-	if (((m_memory.NR42 >> 4) || (m_memory.NR42 & 0x08)) && (m_memory.NR52 & 0x08))
-		generateSamples_channel4(stream, streamLength);
+void SoundController::writeToNR11(u8 value)
+{
+	m_memory.NR11 = value;
+	m_channel1.lengthCounter = 64 - (value & 0x3F);
 }
 
 void SoundController::writeToNR13(u8 value)
 {
 	m_memory.NR13 = value;
-
-	m_channel1.timeOffset += m_channel1.sampleCounter * SAMPLING_PERIOD;
-	m_channel1.waveStepCountOffset += m_channel1.sampleCounter * m_channel1.waveStepsPerSample;
-	m_channel1.sampleCounter = 0;
-
-	u16 x = ((m_memory.NR14 & 0x07) << 8) | m_memory.NR13;
-	f32 waveStepFrequency = 1'048'576.0f / (2048 - x);
-	m_channel1.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
 }
 
 void SoundController::writeToNR14(u8 value)
@@ -143,36 +243,29 @@ void SoundController::writeToNR14(u8 value)
 
 	if (m_memory.NR14 & 0x80) // restart ?
 	{
-		m_channel1.sweepShiftCounter = 0;
-		m_channel1.xShadowRegister = ((m_memory.NR14 & 0x07) << 8) | m_memory.NR13;
-		m_channel1.timeOffset = 0;
-		m_channel1.waveStepCountOffset = 0;
+		trigger(m_channel1, m_memory.NR12);
+		m_channel1.dutyStep = 0;
 		m_memory.NR52 |= 0x01;
-	}
-	else
-	{
-		m_channel1.timeOffset += m_channel1.sampleCounter * SAMPLING_PERIOD;
-		m_channel1.waveStepCountOffset += m_channel1.sampleCounter * m_channel1.waveStepsPerSample;
-	}
 
-	m_channel1.sampleCounter = 0;
+		u8 sweepTime = (m_memory.NR10 >> 4) & 0x07;
+		m_channel1.xShadowRegister = ((m_memory.NR14 & 0x07) << 8) | m_memory.NR13;
+		m_channel1.sweepTimer = sweepTime ? sweepTime : 8;
+		m_channel1.sweepEnabled = sweepTime || (m_memory.NR10 & 0x07);
+
+		if ((m_memory.NR10 & 0x07) && (computeSweepFrequency() > 2047)) // overflow ?
+			m_memory.NR52 &= 0xFE;
+	}
+}
 
-	u16 x = ((m_memory.NR14 & 0x07) << 8) | m_memory.NR13;
-	f32 waveStepFrequency = 1'048'576.0f / (2048 - x);
-	m_channel1.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
+void SoundController::writeToNR21(u8 value)
+{
+	m_memory.NR21 = value;
+	m_channel2.lengthCounter = 64 - (value & 0x3F);
 }
 
 void SoundController::writeToNR23(u8 value)
 {
 	m_memory.NR23 = value;
-
-	m_channel2.timeOffset += m_channel2.sampleCounter * SAMPLING_PERIOD;
-	m_channel2.waveStepCountOffset += m_channel2.sampleCounter * m_channel2.waveStepsPerSample;
-	m_channel2.sampleCounter = 0;
-
-	u16 x = ((m_memory.NR24 & 0x07) << 8) | m_memory.NR23;
-	f32 waveStepFrequency = 1'048'576.0f / (2048 - x);
-	m_channel2.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
 }
 
 void SoundController::writeToNR24(u8 value)
@@ -181,34 +274,22 @@ void SoundController::writeToNR24(u8 value)
 
 	if (m_memory.NR24 & 0x80) // restart ?
 	{
-		m_channel2.timeOffset = 0;
-		m_channel2.waveStepCountOffset = 0;
+		trigger(m_channel2, m_memory.NR22);
+		m_channel2.dutyStep = 0;
 		m_memory.NR52 |= 0x02;
 	}
-	else
-	{
-		m_channel2.timeOffset += m_channel2.sampleCounter * SAMPLING_PERIOD;
-		m_channel2.waveStepCountOffset += m_channel2.sampleCounter * m_channel2.waveStepsPerSample;
-	}
-
-	m_channel2.sampleCounter = 0;
+}
 
-	u16 x = ((m_memory.NR24 & 0x07) << 8) | m_memory.NR23;
-	f32 waveStepFrequency = 1'048'576.0f / (2048 - x);
-	m_channel2.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
+void SoundController::writeToNR31(u8 value)
+{
+	m_memory.NR31 = value;
+	m_channel3.lengthCounter = 256 - value;
 }
 
 void SoundController::writeToNR33(u8 value)
 {
 	m_memory.NR33 = value;
-
-	m_channel3.timeOffset += m_channel3.sampleCounter * SAMPLING_PERIOD;
-	m_channel3.waveStepCountOffset += m_channel3.sampleCounter * m_channel3.waveStepsPerSample;
-	m_channel3.sampleCounter = 0;
-	
-	u16 x = ((m_memory.NR34 & 0x07) << 8) | m_memory.NR33;
-	f32 waveStepFrequency = 2'097'152.0f / (2048 - x);
-	m_channel3.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
+	m_channel3.waveStepsPerSample = getWaveStepsPerSample(((m_memory.NR34 & 0x07) << 8) | m_memory.NR33, m_samplingFrequency);
 }
 
 void SoundController::writeToNR34(u8 value)
@@ -217,21 +298,21 @@ void SoundController::writeToNR34(u8 value)
 
 	if ((m_memory.NR30 & 0x80) && (m_memory.NR34 & 0x80)) // restart ?
 	{
-		m_channel3.timeOffset = 0;
-		m_channel3.waveStepCountOffset = 0;
+		m_channel3.wavePosition = 0;
+
+		if (m_channel3.lengthCounter == 0)
+			m_channel3.lengthCounter = 256;
+
 		m_memory.NR52 |= 0x04;
 	}
-	else
-	{
-		m_channel3.timeOffset += m_channel3.sampleCounter * SAMPLING_PERIOD;
-		m_channel3.waveStepCountOffset += m_channel3.sampleCounter * m_channel3.waveStepsPerSample;
-	}
 
-	m_channel3.sampleCounter = 0;
+	m_channel3.waveStepsPerSample = getWaveStepsPerSample(((m_memory.NR34 & 0x07) << 8) | m_memory.NR33, m_samplingFrequency);
+}
 
-	u16 x = ((m_memory.NR34 & 0x07) << 8) | m_memory.NR33;
-	f32 waveStepFrequency = 2'097'152.0f / (2048 - x);
-	m_channel3.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
+void SoundController::writeToNR41(u8 value)
+{
+	m_memory.NR41 = value;
+	m_channel4.lengthCounter = 64 - (value & 0x3F);
 }
 
 void SoundController::writeToNR44(u8 value)
@@ -240,133 +321,54 @@ void SoundController::writeToNR44(u8 value)
 
 	if (m_memory.NR44 & 0x80) // restart ?
 	{
+		trigger(m_channel4, m_memory.NR42);
 		m_channel4.lfsr = 0x7FFF;
 		m_memory.NR52 |= 0x08;
-		m_channel4.sampleCounter = 0;
 	}
 }
 
-void SoundController::generateSamples_channel1(u8* stream, int streamLength)
+void SoundController::writeToWaveformRam(u16 address, u8 value)
 {
-	std::vector<u8> envelope = getEnvelope(m_memory.NR12);
-	f32 envelopeStepFrequency = 64.0f / (m_memory.NR12 & 0x07);
-
-	std::array<u8, 8> waveform = getRectangleWaveform(m_memory.NR11 >> 6);
-	f32 soundLength = (64 - (m_memory.NR11 & 0x3F)) / 256.0f;
-
-	u8 sweepShiftCount = m_memory.NR10 & 0x07;
-	f32 sweepTime = ((m_memory.NR10 & 0x70) >> 4) / 128.0f;
-
-	for (u16 streamSampleCounter = 0; streamSampleCounter < streamLength; ++streamSampleCounter, ++m_channel1.sampleCounter)
-	{
-		f32 time = m_channel1.sampleCounter * SAMPLING_PERIOD + m_channel1.timeOffset;
-
-		if ((m_memory.NR14 & 0x40) && (time >= soundLength))
-		{
-			m_memory.NR52 &= 0xFE;
-			return;
-		}
-
-		if (sweepTime)
-		{
-			u32 t = (u32)(time / sweepTime);
-			
-			if (t > sweepShiftCount)
-				t = sweepShiftCount;
-
-			if (t != m_channel1.sweepShiftCounter) // sweep ?
-			{
-				m_channel1.sweepShiftCounter = (u8)t;
-
-				u16 x = m_channel1.xShadowRegister;
-
-				if (m_memory.NR10 & 0x08)
-					x -= (x >> sweepShiftCount);
-				else
-					x += (x >> sweepShiftCount);
-
-				if (x > 2047) // overflow ?
-				{
-					m_memory.NR52 &= 0xFE;
-					return;
-				}
-
-				m_channel1.xShadowRegister = x;
-				m_memory.NR13 = x & 0xFF;
-				m_memory.NR14 = (m_memory.NR14 & 0xF8) | (x >> 8);
-				f32 waveStepFrequency = 1'048'576.0f / (2048 - x);
-
-				if (m_memory.NR10 & 0x08)
-					x -= (x >> sweepShiftCount);
-				else
-					x += (x >> sweepShiftCount);
-
-				if (x > 2047) // overflow ?
-				{
-					m_memory.NR52 &= 0xFE;
-					return;
-				}
-
-				m_channel1.timeOffset += m_channel1.sampleCounter * SAMPLING_PERIOD;
-				m_channel1.waveStepCountOffset += m_channel1.sampleCounter * m_channel1.waveStepsPerSample;
-				m_channel1.sampleCounter = 0;
-				m_channel1.waveStepsPerSample = waveStepFrequency / SAMPLING_FREQUENCY;
-			}
-		}
+	m_memory.write(address, value);
 
-		u32 waveStepCount = (u32)(m_channel1.sampleCounter * m_channel1.waveStepsPerSample + m_channel1.waveStepCountOffset);
-		u8 waveStepNumber = waveStepCount % 8;
-
-		if (waveform[waveStepNumber])
-		{
-			u32 envelopeStepCount = (u32)(envelopeStepFrequency * time);
-			u8 step = (envelopeStepCount < envelope.size()) ? envelope[envelopeStepCount] : envelope.back();
-
-			if (m_memory.NR51 & 0x01)
-				stream[streamSampleCounter] += step / m_levelDivisor_so1;
+	u8 stepNumber = (address - Memory::WAVEFORMRAM_ADDRESS) * 2;
+	m_channel3.waveTable[stepNumber] = value >> 4;
+	m_channel3.waveTable[stepNumber + 1] = value & 0x0F;
+}
 
-			if (m_memory.NR51 & 0x10)
-				stream[streamSampleCounter] += step / m_levelDivisor_so2;
-		}
-	}
+void SoundController::runChannels(u64 cycle)
+{
+	runSquareChannel(m_channel1, 0x01, m_memory.NR11, m_memory.NR12, ((m_memory.NR14 & 0x07) << 8) | m_memory.NR13, cycle);
+	runSquareChannel(m_channel2, 0x02, m_memory.NR21, m_memory.NR22, ((m_memory.NR24 & 0x07) << 8) | m_memory.NR23, cycle);
+	runNoiseChannel(cycle);
 }
 
-void SoundController::generateSamples_channel2(u8* stream, int streamLength)
+void SoundController::runSquareChannel(SquareChannel& channel, u8 channelFlag, u8 dutyRegister, u8 envelopeRegister, u16 x, u64 cycle)
 {
-	std::vector<u8> envelope = getEnvelope(m_memory.NR22);
-	f32 envelopeStepFrequency = 64.0f / (m_memory.NR22 & 0x07);
+	if (!isChannelOn(channel, channelFlag, envelopeRegister, cycle))
+		return;
 
-	std::array<u8, 8> waveform = getRectangleWaveform(m_memory.NR21 >> 6);
-	f32 soundLength = (64 - (m_memory.NR21 & 0x3F)) / 256.0f;
+	std::array<u8, 8> waveform = getRectangleWaveform(dutyRegister >> 6);
 
-	for (u16 streamSampleCounter = 0; streamSampleCounter < streamLength; ++streamSampleCounter, ++m_channel2.sampleCounter)
+	for (; channel.stepCycle <= cycle; channel.stepCycle += 2048 - x)
 	{
-		f32 time = m_channel2.sampleCounter * SAMPLING_PERIOD + m_channel2.timeOffset;
-		
-		if ((m_memory.NR24 & 0x40) && (time >= soundLength))
-		{
-			m_memory.NR52 &= 0xFD;
-			return;
-		}
-
-		u32 waveStepCount = (u32)(m_channel2.sampleCounter * m_channel2.waveStepsPerSample + m_channel2.waveStepCountOffset);
-		u8 waveStepNumber = waveStepCount % 8;
-
-		if (waveform[waveStepNumber])
-		{
-			u32 envelopeStepCount = (u32)(envelopeStepFrequency * time);
-			u8 step = (envelopeStepCount < envelope.size()) ? envelope[envelopeStepCount] : envelope.back();
+		channel.high = waveform[channel.dutyStep] != 0;
+		channel.dutyStep = (channel.dutyStep + 1) % 8;
+		updateAmplitude(channel, channel.stepCycle);
+	}
+}
 
-			if (m_memory.NR51 & 0x02)
-				stream[streamSampleCounter] += step / m_levelDivisor_so1;
+bool SoundController::isChannel3On() const
+{
+	return ((m_memory.NR52 & 0x84) == 0x84) && (m_memory.NR30 & 0x80);
+}
 
-			if (m_memory.NR51 & 0x20)
-				stream[streamSampleCounter] += step / m_levelDivisor_so2;
-		}
-	}
+bool SoundController::isChannel3Silent() const
+{
+	return !isChannel3On() || !(m_memory.NR32 & 0x60);
 }
 
-void SoundController::generateSamples_channel3(u8* stream, int streamLength)
+void SoundController::generateSamples_channel3(s16* samples, u16 sampleCount)
 {
 	u8 levelShift = [this]() -> u8
 	{
@@ -380,83 +382,173 @@ void SoundController::generateSamples_channel3(u8* stream, int streamLength)
 		}
 	}();
 
-	f32 soundLength = (256 - m_memory.NR31) / 256.0f;
+	for (u16 sampleNumber = 0; sampleNumber < sampleCount; ++sampleNumber, m_channel3.wavePosition += m_channel3.waveStepsPerSample)
+	{
+		u8 step = m_channel3.waveTable[(m_channel3.wavePosition >> WAVE_POSITION_SHIFT) % 32];
+		samples[sampleNumber] = (s16)((2 * (step >> levelShift) - (15 >> levelShift)) << AMPLITUDE_SHIFT);
+	}
+}
+
+void SoundController::runNoiseChannel(u64 cycle)
+{
+	if (!isChannelOn(m_channel4, 0x08, m_memory.NR42, cycle))
+		return;
+
+	u8 r = m_memory.NR43 & 0x07;
+	u8 s = m_memory.NR43 >> 4;
+	u32 stepCycleCount = (r == 0 ? 1 : 2 * r) << (s + 1);
 
-	for (u16 streamSampleCounter = 0; streamSampleCounter < streamLength; ++streamSampleCounter, ++m_channel3.sampleCounter)
+	for (; m_channel4.stepCycle <= cycle; m_channel4.stepCycle += stepCycleCount)
 	{
-		if (m_memory.NR34 & 0x40)
-		{
-			f32 time = m_channel3.sampleCounter * SAMPLING_PERIOD + m_channel3.timeOffset;
+		m_channel4.high = (m_channel4.lfsr & 1) != 0;
+		updateAmplitude(m_channel4, m_channel4.stepCycle);
 
-			if (time >= soundLength)
-			{
-				m_memory.NR52 &= 0xFB;
-				return;
-			}
-		}
+		u8 bit0 = m_channel4.lfsr & 1;
+		m_channel4.lfsr >>= 1;
+		u8 bit1 = m_channel4.lfsr & 1;
+
+		u8 result = bit1 ^ bit0;
+		m_channel4.lfsr |= result << 14;
+
+		if (m_memory.NR43 & 0x08)
+			m_channel4.lfsr = (result << 6) | (m_channel4.lfsr & 0xFFBF);
+	}
+}
 
-		u32 stepCount = (u32)(m_channel3.sampleCounter * m_channel3.waveStepsPerSample + m_channel3.waveStepCountOffset);
-		u8 stepNumber = stepCount % 32;
-		u8 step = (stepNumber % 2) ? (m_memory.read(0xFF30 + stepNumber / 2) & 0x0F) : (m_memory.read(0xFF30 + stepNumber / 2) >> 4);
-		step >>= levelShift;
+// a channel that is off or whose DAC is off outputs 0 and does not step
+bool SoundController::isChannelOn(SteppedChannel& channel, u8 channelFlag, u8 envelopeRegister, u64 cycle)
+{
+	if ((m_memory.NR52 & 0x80) && (m_memory.NR52 & channelFlag) && ((envelopeRegister >> 4) || (envelopeRegister & 0x08)))
+		return true;
 
-		if (m_memory.NR51 & 0x04)
-			stream[streamSampleCounter] += step / m_levelDivisor_so1;
+	channel.high = false;
+	setAmplitude(channel, cycle, 0);
+	channel.stepCycle = std::max(channel.stepCycle, cycle);
+	return false;
+}
 
-		if (m_memory.NR51 & 0x40)
-			stream[streamSampleCounter] += step / m_levelDivisor_so2;
+void SoundController::setAmplitude(SteppedChannel& channel, u64 cycle, s16 amplitude)
+{
+	if (amplitude != channel.amplitude)
+	{
+		channel.blipBuffer.addDelta(getSampleTime(cycle), amplitude - channel.amplitude);
+		channel.amplitude = amplitude;
 	}
 }
 
-void SoundController::generateSamples_channel4(u8* stream, int streamLength)
+void SoundController::updateAmplitude(SteppedChannel& channel, u64 cycle)
 {
-	std::vector<u8> envelope = getEnvelope(m_memory.NR42);
-	f32 envelopeStepFrequency = 64.0f / (m_memory.NR42 & 0x07);
+	s16 amplitude = channel.volume << AMPLITUDE_SHIFT;
+	setAmplitude(channel, cycle, channel.high ? amplitude : -amplitude);
+}
 
-	f32 soundLength = (64 - (m_memory.NR41 & 0x3F)) / 256.0f;
+// the length counter is loaded by the writes to NRx1, a restart only reloads it once it has expired
+void SoundController::trigger(SteppedChannel& channel, u8 envelopeRegister)
+{
+	channel.stepCycle = m_scheduler.getCurrentCycle();
 
-	u8 r = m_memory.NR43 & 0x07;
-	u8 s = m_memory.NR43 >> 4;
-	f32 stepFrequency = 524'288.0f / (r == 0 ? 0.5f : r) / (1 << (s + 1));
-	f32 waveStepsPerSample = stepFrequency / SAMPLING_FREQUENCY;
+	if (channel.lengthCounter == 0)
+		channel.lengthCounter = 64;
 
-	static f32 stepCounter = 0;
+	channel.volume = envelopeRegister >> 4;
+	channel.envelopeTimer = envelopeRegister & 0x07;
+}
 
-	for (u16 streamSampleCounter = 0; streamSampleCounter < streamLength; ++streamSampleCounter, ++m_channel4.sampleCounter, stepCounter += waveStepsPerSample)
+void SoundController::clockFrameSequencer(u64 cycle)
+{
+	if ((m_frameSequencerStep % 2) == 0)
 	{
-		f32 time = m_channel4.sampleCounter * SAMPLING_PERIOD;
+		clockLength(m_channel1.lengthCounter, m_memory.NR14, 0x01);
+		clockLength(m_channel2.lengthCounter, m_memory.NR24, 0x02);
+		clockLength(m_channel3.lengthCounter, m_memory.NR34, 0x04);
+		clockLength(m_channel4.lengthCounter, m_memory.NR44, 0x08);
+	}
 
-		if ((m_memory.NR44 & 0x40) && (time >= soundLength))
-		{
-			m_memory.NR52 &= 0xF7;
-			return;
-		}
+	if ((m_frameSequencerStep == 2) || (m_frameSequencerStep == 6))
+		clockSweep();
 
-		while (stepCounter >= 1)
-		{
-			--stepCounter;
+	if ((m_frameSequencerStep == 7) && m_audioSink)
+	{
+		clockEnvelope(m_channel1, m_memory.NR12, cycle);
+		clockEnvelope(m_channel2, m_memory.NR22, cycle);
+		clockEnvelope(m_channel4, m_memory.NR42, cycle);
+	}
 
-			u8 bit0 = m_channel4.lfsr & 1;
-			m_channel4.lfsr >>= 1;
-			u8 bit1 = m_channel4.lfsr & 1;
+	m_frameSequencerStep = (m_frameSequencerStep + 1) % 8;
 
-			u8 result = bit1 ^ bit0;
-			m_channel4.lfsr |= result << 14;
+	// silences the channels stopped by their length counter or the sweep at this cycle
+	if (m_audioSink)
+		runChannels(cycle);
+}
 
-			if (m_memory.NR43 & 0x08)
-				m_channel4.lfsr = (result << 6) | (m_channel4.lfsr & 0xFFBF);
-		}
+void SoundController::clockLength(u16& lengthCounter, u8 lengthEnableRegister, u8 channelFlag)
+{
+	if ((lengthEnableRegister & 0x40) && (lengthCounter > 0) && (--lengthCounter == 0))
+		m_memory.NR52 &= (u8)~channelFlag;
+}
 
-		if (m_channel4.lfsr & 1)
-		{
-			u32 envelopeStepCount = (u32)(envelopeStepFrequency * time);
-			u8 step = (envelopeStepCount < envelope.size()) ? envelope[envelopeStepCount] : envelope.back();
+void SoundController::clockEnvelope(SteppedChannel& channel, u8 envelopeRegister, u64 cycle)
+{
+	u8 envelopePeriod = envelopeRegister & 0x07;
 
-			if (m_memory.NR51 & 0x08)
-				stream[streamSampleCounter] += step / m_levelDivisor_so1;
+	if (envelopePeriod == 0)
+		return;
 
-			if (m_memory.NR51 & 0x80)
-				stream[streamSampleCounter] += step / m_levelDivisor_so2;
-		}
+	if (channel.envelopeTimer > 1)
+	{
+		--channel.envelopeTimer;
+		return;
+	}
+
+	channel.envelopeTimer = envelopePeriod;
+
+	if ((envelopeRegister & 0x08) && (channel.volume < 15))
+		++channel.volume;
+	else if (!(envelopeRegister & 0x08) && (channel.volume > 0))
+		--channel.volume;
+	else
+		return;
+
+	updateAmplitude(channel, cycle);
+}
+
+void SoundController::clockSweep()
+{
+	u8 sweepTime = (m_memory.NR10 >> 4) & 0x07;
+
+	if (m_channel1.sweepTimer > 1)
+	{
+		--m_channel1.sweepTimer;
+		return;
+	}
+
+	m_channel1.sweepTimer = sweepTime ? sweepTime : 8;
+
+	if (!m_channel1.sweepEnabled || (sweepTime == 0))
+		return;
+
+	u16 x = computeSweepFrequency();
+
+	if (x > 2047) // overflow ?
+	{
+		m_memory.NR52 &= 0xFE;
+		return;
+	}
+
+	if (m_memory.NR10 & 0x07)
+	{
+		m_channel1.xShadowRegister = x;
+		m_memory.NR13 = x & 0xFF;
+		m_memory.NR14 = (m_memory.NR14 & 0xF8) | (x >> 8);
+
+		if (computeSweepFrequency() > 2047) // overflow ?
+			m_memory.NR52 &= 0xFE;
 	}
 }
+
+u16 SoundController::computeSweepFrequency()
+{
+	u16 x = m_channel1.xShadowRegister;
+	u8 sweepShiftCount = m_memory.NR10 & 0x07;
+	return (m_memory.NR10 & 0x08) ? x - (x >> sweepShiftCount) : x + (x >> sweepShiftCount);
+}
@@ -19,54 +19,124 @@ along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <vector>
+
 #include "Types.h"
+#include "BlipBuffer.h"
+#include "Mixer.h"
+#include "AudioSink.h"
+#include "Resampler.h"
 
 class Memory;
+class Scheduler;
+struct Settings;
 
 class SoundController
 {
 public:
-	SoundController(Memory& memory);
-	~SoundController();
+	SoundController(Memory& memory, Scheduler& scheduler, const Settings& settings);
 
-	void generateSamples(u8* stream, int streamLength);
+	// generates the samples up to the current cycle before a sound register is accessed
+	void synchronize(u16 address);
 
+	void writeToNR11(u8 value);
 	void writeToNR13(u8 value);
 	void writeToNR14(u8 value);
+	void writeToNR21(u8 value);
 	void writeToNR23(u8 value);
 	void writeToNR24(u8 value);
+	void writeToNR31(u8 value);
 	void writeToNR33(u8 value);
 	void writeToNR34(u8 value);
+	void writeToNR41(u8 value);
 	void writeToNR44(u8 value);
+	void writeToWaveformRam(u16 address, u8 value);
 
 private:
-	void generateSamples_channel1(u8* stream, int streamLength);
-	void generateSamples_channel2(u8* stream, int streamLength);
-	void generateSamples_channel3(u8* stream, int streamLength);
-	void generateSamples_channel4(u8* stream, int streamLength);
+	// channel whose amplitude changes are placed at their exact cycle in a band-limited buffer
+	struct SteppedChannel
+	{
+		u64 stepCycle = 0;
+		bool high = false;
+		s16 amplitude = 0;
+		u16 lengthCounter = 0;
+		u8 volume = 0;
+		u8 envelopeTimer = 0;
+		BlipBuffer blipBuffer;
+	};
+
+	struct SquareChannel : SteppedChannel
+	{
+		u8 dutyStep = 0;
+	};
+
+	void synchronize();
+	void run(u64 cycle);
+	u64 getSampleTime(u64 cycle) const;
+	void updateSamplingFrequency();
+	void generateSamples(StereoSample* stream, u16 streamLength);
+	bool isChannel3On() const;
+	bool isChannel3Silent() const;
+	void generateSamples_channel3(s16* samples, u16 sampleCount);
+
+	void runChannels(u64 cycle);
+	void runSquareChannel(SquareChannel& channel, u8 channelFlag, u8 dutyRegister, u8 envelopeRegister, u16 x, u64 cycle);
+	void runNoiseChannel(u64 cycle);
+	bool isChannelOn(SteppedChannel& channel, u8 channelFlag, u8 envelopeRegister, u64 cycle);
+	void setAmplitude(SteppedChannel& channel, u64 cycle, s16 amplitude);
+	void updateAmplitude(SteppedChannel& channel, u64 cycle);
+	void trigger(SteppedChannel& channel, u8 envelopeRegister);
+
+	void clockFrameSequencer(u64 cycle);
+	void clockLength(u16& lengthCounter, u8 lengthEnableRegister, u8 channelFlag);
+	void clockEnvelope(SteppedChannel& channel, u8 envelopeRegister, u64 cycle);
+	void clockSweep();
+	u16 computeSweepFrequency();
 
 	Memory& m_memory;
+	Scheduler& m_scheduler;
+
+	// null when the sound is disabled, nothing is generated then
+	std::unique_ptr<AudioSink> m_audioSink;
+	Mixer m_mixer;
+	u64 m_sampleCount = 0;
+
+	// BlipBuffer time of m_baseCycle, later cycles advance it by the sampling frequency
+	u32 m_samplingFrequency;
+	u64 m_baseCycle = 0;
+	u64 m_baseTime = 0;
 
-	u8 m_levelDivisor_so1 = 0;
-	u8 m_levelDivisor_so2 = 0;
+	// with the native APU the channels are generated at the cycle rate and converted to the output rate
+	std::unique_ptr<Resampler> m_resampler;
+	std::vector<StereoSample> m_resampledSamples;
 
-	struct Channel
+	// steps at 512 Hz: length on even steps, sweep on steps 2 and 6, envelope on step 7
+	u64 m_frameSequencerCycle = 0;
+	u8 m_frameSequencerStep = 0;
+
+	// point-sampled, the wave position is a fixed-point step count advanced once per sample
+	struct
 	{
-		u32 sampleCounter = 0;
-		f32 waveStepCountOffset = 0;
-		f32 timeOffset = 0;
-		f32 waveStepsPerSample = 0;
-	} m_channel2, m_channel3;
+		// the 32 4-bit samples of the waveform RAM, decoded on write
+		std::array<u8, 32> waveTable;
+		u32 wavePosition = 0;
+		u32 waveStepsPerSample = 0;
+		u16 lengthCounter = 0;
+	} m_channel3;
 
-	struct : Channel
+	SquareChannel m_channel2;
+
+	struct : SquareChannel
 	{
-		u8 sweepShiftCounter = 0;
+		bool sweepEnabled = false;
+		u8 sweepTimer = 0;
 		u16 xShadowRegister = 0;
 	} m_channel1;
 
-	struct
+	struct : SteppedChannel
 	{
-		u32 sampleCounter = 0;
 		u16 lfsr = 0x7FFF;
 	} m_channel4;
 };
@@ -0,0 +1,91 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+
+#include "ThreadedFrameSink.h"
+
+ThreadedFrameSink::ThreadedFrameSink(std::unique_ptr<SdlFrameSink> frameSink) : m_frameSink(std::move(frameSink))
+{
+	m_thread = std::thread(&ThreadedFrameSink::scale, this);
+}
+
+ThreadedFrameSink::~ThreadedFrameSink()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopRequested = true;
+		m_newFrameCondition.notify_one();
+	}
+
+	m_thread.join();
+}
+
+bool ThreadedFrameSink::isEnabled()
+{
+	return m_frameSink->isEnabled();
+}
+
+void ThreadedFrameSink::drawFrame(const Frame& frame)
+{
+	m_frames.getWriteBuffer() = frame;
+
+	// the lock only covers the exchange of the buffers, so that the notification can't be missed
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_frames.publish();
+	m_newFrameCondition.notify_one();
+}
+
+void ThreadedFrameSink::present()
+{
+	// the events are still polled about once per frame when no frame comes
+	constexpr auto WAIT_TIMEOUT = std::chrono::milliseconds(16);
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_scaledFrameCondition.wait_for(lock, WAIT_TIMEOUT, [this] { return m_scaledFrames.hasNewBuffer(); });
+	}
+
+	if (m_scaledFrames.update())
+		m_frameSink->presentScaledFrame(m_scaledFrames.getReadBuffer().data());
+}
+
+void ThreadedFrameSink::scale()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_newFrameCondition.wait(lock, [this] { return m_frames.hasNewBuffer() || m_stopRequested; });
+
+			if (m_stopRequested)
+				return;
+		}
+
+		m_frames.update();
+
+		std::vector<u32>& scaledFrame = m_scaledFrames.getWriteBuffer();
+		scaledFrame.resize(m_frameSink->getScaledFrameSize());
+		m_frameSink->scaleFrame(m_frames.getReadBuffer(), scaledFrame.data());
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_scaledFrames.publish();
+		m_scaledFrameCondition.notify_one();
+	}
+}
@@ -0,0 +1,55 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "SdlFrameSink.h"
+#include "TripleBuffer.h"
+
+// scales the frames of the window on a dedicated thread, the main thread shows the newest scaled frame in present.
+// SDL video calls stay on the main thread, the emulation runs on its own thread and never waits on the window
+class ThreadedFrameSink : public FrameSink
+{
+public:
+	ThreadedFrameSink(std::unique_ptr<SdlFrameSink> frameSink);
+	~ThreadedFrameSink();
+
+	bool isEnabled() override;
+	void drawFrame(const Frame& frame) override;
+	void present() override;
+
+private:
+	void scale();
+
+	std::unique_ptr<SdlFrameSink> m_frameSink;
+	TripleBuffer<Frame> m_frames;
+	TripleBuffer<std::vector<u32>> m_scaledFrames;
+
+	bool m_stopRequested = false;
+	std::mutex m_mutex;
+	std::condition_variable m_newFrameCondition;
+	std::condition_variable m_scaledFrameCondition;
+	std::thread m_thread;
+};
@@ -0,0 +1,72 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "Types.h"
+
+// lock-free single producer / single consumer triple buffer, the consumer always gets the newest published buffer
+template<typename T>
+class TripleBuffer
+{
+public:
+	T& getWriteBuffer()
+	{
+		return m_buffers[m_writeIndex];
+	}
+
+	void publish()
+	{
+		m_writeIndex = m_middleIndex.exchange(m_writeIndex | NEW_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	bool hasNewBuffer()
+	{
+		return m_middleIndex.load(std::memory_order_acquire) & NEW_FLAG;
+	}
+
+	bool update()
+	{
+		if (!hasNewBuffer())
+			return false;
+
+		m_readIndex = m_middleIndex.exchange(m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	const T& getReadBuffer()
+	{
+		return m_buffers[m_readIndex];
+	}
+
+private:
+	enum : u8
+	{
+		INDEX_MASK = 0x03,
+		NEW_FLAG = 0x04
+	};
+
+	std::array<T, 3> m_buffers{};
+	u8 m_writeIndex = 0;
+	std::atomic<u8> m_middleIndex{1};
+	u8 m_readIndex = 2;
+};
@@ -0,0 +1,170 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+#include "Error.h"
+#include "WavAudioSink.h"
+
+constexpr size_t BLOCK_SIZE = 4096;
+constexpr size_t QUEUE_CAPACITY = 16;
+
+// the RIFF size counts the data and the 36 bytes of header that follow it, on 32 bits
+constexpr u32 MAX_SAMPLE_COUNT = (0xFFFFFFFF - 36) / sizeof(StereoSample);
+
+void write_u16(std::ofstream& file, u16 value)
+{
+	file.put((char)(value & 0xFF));
+	file.put((char)(value >> 8));
+}
+
+void write_u32(std::ofstream& file, u32 value)
+{
+	write_u16(file, value & 0xFFFF);
+	write_u16(file, value >> 16);
+}
+
+WavAudioSink::WavAudioSink(const std::string& filename, u32 samplingFrequency) :
+	m_file(filename, std::ios::binary),
+	m_samplingFrequency(samplingFrequency)
+{
+	if (!m_file)
+		throwError("Failed to open ", filename);
+
+	// the sizes are written once the number of samples is known
+	writeHeader(0);
+
+	m_block.reserve(BLOCK_SIZE);
+	m_thread = std::thread(&WavAudioSink::write, this);
+}
+
+WavAudioSink::~WavAudioSink()
+{
+	pushBlock();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmptyCondition.notify_one();
+	}
+
+	m_thread.join();
+
+	m_file.seekp(0);
+	writeHeader(m_sampleCount * sizeof(StereoSample));
+}
+
+// the file is closed to new samples once it reaches the size limit of the format
+void WavAudioSink::writeSamples(const StereoSample* samples, u16 sampleCount)
+{
+	if (m_sampleCount + sampleCount > MAX_SAMPLE_COUNT)
+	{
+		if (!m_full)
+			std::cerr << "The WAV file reached its maximum size, the rest of the audio is not written" << std::endl;
+
+		m_full = true;
+
+		sampleCount = (u16)(MAX_SAMPLE_COUNT - m_sampleCount);
+	}
+
+	m_block.insert(m_block.end(), samples, samples + sampleCount);
+	m_sampleCount += sampleCount;
+
+	if (m_block.size() >= BLOCK_SIZE)
+		pushBlock();
+}
+
+u32 WavAudioSink::getSamplingFrequency() const
+{
+	return m_samplingFrequency;
+}
+
+// blocks while the writer thread is behind
+void WavAudioSink::pushBlock()
+{
+	if (m_block.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_notFullCondition.wait(lock, [this] { return m_blocks.size() < QUEUE_CAPACITY; });
+
+	m_blocks.push_back(std::move(m_block));
+	m_notEmptyCondition.notify_one();
+
+	m_block = std::vector<StereoSample>();
+	m_block.reserve(BLOCK_SIZE);
+}
+
+void WavAudioSink::write()
+{
+	std::vector<u8> buffer;
+
+	while (true)
+	{
+		std::vector<StereoSample> block;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notEmptyCondition.wait(lock, [this] { return !m_blocks.empty() || m_closed; });
+
+			if (m_blocks.empty())
+				break;
+
+			block = std::move(m_blocks.front());
+			m_blocks.pop_front();
+			m_notFullCondition.notify_one();
+		}
+
+		// little-endian whatever the host
+		buffer.resize(block.size() * 4);
+
+		for (size_t sampleNumber = 0; sampleNumber < block.size(); ++sampleNumber)
+		{
+			buffer[sampleNumber * 4] = (u8)block[sampleNumber].left;
+			buffer[sampleNumber * 4 + 1] = (u8)((u16)block[sampleNumber].left >> 8);
+			buffer[sampleNumber * 4 + 2] = (u8)block[sampleNumber].right;
+			buffer[sampleNumber * 4 + 3] = (u8)((u16)block[sampleNumber].right >> 8);
+		}
+
+		m_file.write((const char*)buffer.data(), buffer.size());
+	}
+
+	m_file.flush();
+}
+
+void WavAudioSink::writeHeader(u32 dataSize)
+{
+	constexpr u16 CHANNEL_COUNT = 2;
+	constexpr u16 BITS_PER_SAMPLE = 16;
+	constexpr u16 BLOCK_ALIGN = CHANNEL_COUNT * BITS_PER_SAMPLE / 8;
+
+	m_file.write("RIFF", 4);
+	write_u32(m_file, 36 + dataSize);
+	m_file.write("WAVEfmt ", 8);
+	write_u32(m_file, 16);
+	write_u16(m_file, 1); // PCM
+	write_u16(m_file, CHANNEL_COUNT);
+	write_u32(m_file, m_samplingFrequency);
+	write_u32(m_file, m_samplingFrequency * BLOCK_ALIGN);
+	write_u16(m_file, BLOCK_ALIGN);
+	write_u16(m_file, BITS_PER_SAMPLE);
+	m_file.write("data", 4);
+	write_u32(m_file, dataSize);
+}
@@ -0,0 +1,61 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "AudioSink.h"
+
+// writes the samples to a 16-bit stereo WAV file from a writer thread, nothing is dropped
+class WavAudioSink : public AudioSink
+{
+public:
+	WavAudioSink(const std::string& filename, u32 samplingFrequency);
+	~WavAudioSink();
+
+	void writeSamples(const StereoSample* samples, u16 sampleCount) override;
+	u32 getSamplingFrequency() const override;
+
+private:
+	void pushBlock();
+	void write();
+	void writeHeader(u32 dataSize);
+
+	std::ofstream m_file;
+	u32 m_samplingFrequency;
+	u32 m_sampleCount = 0;
+	bool m_full = false;
+
+	// filled by the emulation thread, then queued for the writer thread
+	std::vector<StereoSample> m_block;
+	std::deque<std::vector<StereoSample>> m_blocks;
+	bool m_closed = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_notEmptyCondition;
+	std::condition_variable m_notFullCondition;
+	std::thread m_thread;
+};
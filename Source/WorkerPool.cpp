@@ -0,0 +1,89 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(u8 threadCount)
+{
+	for (u8 threadNumber = 0; threadNumber < threadCount; ++threadNumber)
+		m_threads.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_startCondition.notify_all();
+
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+void WorkerPool::run(u16 taskCount, const std::function<void(u16)>& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_taskCount = taskCount;
+		m_nextTaskNumber = 0;
+		m_busyThreadCount = (u8)m_threads.size();
+		++m_generation;
+	}
+
+	m_startCondition.notify_all();
+	runTasks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this] { return m_busyThreadCount == 0; });
+	m_task = nullptr;
+}
+
+void WorkerPool::work()
+{
+	u32 generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_startCondition.wait(lock, [&] { return m_stop || (m_generation != generation); });
+
+			if (m_stop)
+				return;
+
+			generation = m_generation;
+		}
+
+		runTasks();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (--m_busyThreadCount == 0)
+			m_doneCondition.notify_one();
+	}
+}
+
+void WorkerPool::runTasks()
+{
+	for (u16 taskNumber = m_nextTaskNumber++; taskNumber < m_taskCount; taskNumber = m_nextTaskNumber++)
+		(*m_task)(taskNumber);
+}
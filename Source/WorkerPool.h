@@ -0,0 +1,55 @@
+/*
+Copyright 2017-2020 Wilfried Rabouin
+
+This file is part of CppGB.
+
+CppGB is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+CppGB is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CppGB.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "Types.h"
+
+class WorkerPool
+{
+public:
+	explicit WorkerPool(u8 threadCount);
+	~WorkerPool();
+
+	// runs task(0) to task(taskCount - 1) on the pool and the calling thread, returns once all of them are done
+	void run(u16 taskCount, const std::function<void(u16)>& task);
+
+private:
+	void work();
+	void runTasks();
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+
+	const std::function<void(u16)>* m_task = nullptr;
+	u16 m_taskCount = 0;
+	std::atomic<u16> m_nextTaskNumber{ 0 };
+	u8 m_busyThreadCount = 0;
+	u32 m_generation = 0;
+	bool m_stop = false;
+};